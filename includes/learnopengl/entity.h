@@ -6,6 +6,9 @@
 #include <array> //std::array
 #include <memory> //std::unique_ptr
 
+#include <learnopengl/frustum.h> //Plane, Frustum
+#include <learnopengl/render_queue.h> //RenderQueue
+
 class Transform
 {
 protected:
@@ -122,36 +125,6 @@ public:
 	}
 };
 
-struct Plane
-{
-	glm::vec3 normal = { 0.f, 1.f, 0.f }; // unit vector
-	float     distance = 0.f;        // Distance with origin
-
-	Plane() = default;
-
-	Plane(const glm::vec3& p1, const glm::vec3& norm)
-		: normal(glm::normalize(norm)),
-		distance(glm::dot(normal, p1))
-	{}
-
-	float getSignedDistanceToPlane(const glm::vec3& point) const
-	{
-		return glm::dot(normal, point) - distance;
-	}
-};
-
-struct Frustum
-{
-	Plane topFace;
-	Plane bottomFace;
-
-	Plane rightFace;
-	Plane leftFace;
-
-	Plane farFace;
-	Plane nearFace;
-};
-
 struct BoundingVolume
 {
 	virtual bool isOnFrustum(const Frustum& camFrustum, const Transform& transform) const = 0;
@@ -342,22 +315,53 @@ Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, flo
 	return frustum;
 }
 
+//Camera information needed to turn a bounding sphere into a size on screen for level of detail selection
+struct LodSelection
+{
+	glm::vec3 cameraPosition = { 0.f, 0.f, 0.f };
+	float projectionScale = 1.f; // screen height in pixels / (2 * tan(fovY / 2))
+	float pixelError = 1.f;      // largest simplification error allowed on screen, in pixels
+	float hysteresis = 0.25f;    // a coarser level must be this fraction below pixelError before switching to it
+	TextureStreamer* textureStreamer = nullptr; // when set, visible entities request texture resolution from it
+};
+
+LodSelection createLodSelectionFromCamera(const Camera& cam, float fovY, float screenHeight, float pixelError = 1.f)
+{
+	LodSelection selection;
+	selection.cameraPosition = cam.Position;
+	selection.projectionScale = screenHeight / (2.f * tanf(fovY * .5f));
+	selection.pixelError = pixelError;
+	return selection;
+}
+
+//Per frame counters filled by Entity::drawSelfAndChild
+struct DrawStatistics
+{
+	unsigned int display = 0;
+	unsigned int total = 0;
+	unsigned int triangles = 0;           // triangles submitted with the selected levels of detail
+	unsigned int trianglesFullDetail = 0; // triangles the same entities would have submitted at full detail
+	unsigned int clustersTested = 0;
+	unsigned int clustersVisible = 0;
+	unsigned int programChanges = 0;      // state changes between the sorted draws
+	unsigned int materialChanges = 0;
+	unsigned int meshChanges = 0;
+};
+
 AABB generateAABB(const Model& model)
 {
 	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
+	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::lowest());
+	//Use the bounds each mesh computed at load, the vertices may already have been released after upload
 	for (auto&& mesh : model.meshes)
 	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
+		minAABB.x = std::min(minAABB.x, mesh.boundsMin.x);
+		minAABB.y = std::min(minAABB.y, mesh.boundsMin.y);
+		minAABB.z = std::min(minAABB.z, mesh.boundsMin.z);
 
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
+		maxAABB.x = std::max(maxAABB.x, mesh.boundsMax.x);
+		maxAABB.y = std::max(maxAABB.y, mesh.boundsMax.y);
+		maxAABB.z = std::max(maxAABB.z, mesh.boundsMax.z);
 	}
 	return AABB(minAABB, maxAABB);
 }
@@ -365,19 +369,17 @@ AABB generateAABB(const Model& model)
 Sphere generateSphereBV(const Model& model)
 {
 	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
+	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::lowest());
+	//Use the bounds each mesh computed at load, the vertices may already have been released after upload
 	for (auto&& mesh : model.meshes)
 	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
+		minAABB.x = std::min(minAABB.x, mesh.boundsMin.x);
+		minAABB.y = std::min(minAABB.y, mesh.boundsMin.y);
+		minAABB.z = std::min(minAABB.z, mesh.boundsMin.z);
 
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
+		maxAABB.x = std::max(maxAABB.x, mesh.boundsMax.x);
+		maxAABB.y = std::max(maxAABB.y, mesh.boundsMax.y);
+		maxAABB.z = std::max(maxAABB.z, mesh.boundsMax.z);
 	}
 
 	return Sphere((maxAABB + minAABB) * 0.5f, glm::length(minAABB - maxAABB));
@@ -396,6 +398,9 @@ public:
 	Model* pModel = nullptr;
 	std::unique_ptr<AABB> boundingVolume;
 
+	//Level of detail used last frame, kept so selection can apply hysteresis
+	unsigned int currentLod = 0;
+
 
 	// constructor, expects a filepath to a 3D model.
 	Entity(Model& model) : pModel{ &model }
@@ -466,6 +471,92 @@ public:
 	}
 
 
+	//Select a level of detail from the projected size of the bounding sphere.
+	//The relative simplification error of a level times the projected diameter gives its error in pixels.
+	unsigned int selectLod(const LodSelection& selection)
+	{
+		const std::vector<float>& errors = pModel->lodErrors;
+		if (errors.size() < 2)
+			return currentLod = 0;
+
+		const AABB globalAABB = getGlobalAABB();
+		const float radius = glm::length(globalAABB.extents);
+		const float distance = glm::length(globalAABB.center - selection.cameraPosition);
+		//Camera inside the bounding sphere: always full detail
+		if (distance <= radius)
+			return currentLod = 0;
+
+		const float projectedDiameter = 2.f * radius * selection.projectionScale / distance;
+		unsigned int lod = std::min<unsigned int>(currentLod, static_cast<unsigned int>(errors.size() - 1));
+		//Refine as soon as the current level's error becomes visible...
+		while (lod > 0 && errors[lod] * projectedDiameter > selection.pixelError)
+			lod--;
+		//...but only coarsen once the next level is well below the threshold, so objects near a boundary don't flicker
+		while (lod + 1 < errors.size() && errors[lod + 1] * projectedDiameter < selection.pixelError * (1.f - selection.hysteresis))
+			lod++;
+		return currentLod = lod;
+	}
+
+	//Ask the texture streamer for the resolution each mesh needs at its distance: the nearest point of the
+	//bounding sphere, so the side facing the camera never gets too blurry
+	void requestTextureResolution(const LodSelection& selection)
+	{
+		const AABB globalAABB = getGlobalAABB();
+		const float radius = glm::length(globalAABB.extents);
+		const float distance = std::max(glm::length(globalAABB.center - selection.cameraPosition) - radius, 1e-3f);
+		const glm::vec3 globalScale = transform.getGlobalScale();
+		const float scale = std::max(std::max(globalScale.x, globalScale.y), globalScale.z);
+		//screen pixels per world unit, times world units per model unit, over UV units per model unit
+		const float pixelsPerModelUnit = selection.projectionScale / distance * scale;
+		for (auto&& mesh : pModel->meshes)
+		{
+			if (mesh.uvDensity <= 0.f)
+				continue;
+			for (auto&& texture : mesh.textures)
+				selection.textureStreamer->requestResolution(texture.id, pixelsPerModelUnit / mesh.uvDensity);
+		}
+	}
+
+	//Push a draw packet for each mesh of every visible entity, keyed by its distance to the camera. Nothing is drawn
+	//here: the queue sorts the packets by state and depth before submitting them
+	void enqueueSelfAndChild(const Frustum& frustum, Shader& ourShader, const LodSelection& lodSelection, RenderQueue& queue, DrawStatistics& stats)
+	{
+		if (boundingVolume->isOnFrustum(frustum, transform))
+		{
+			if (lodSelection.textureStreamer)
+				requestTextureResolution(lodSelection);
+			const unsigned int lod = selectLod(lodSelection);
+			const float depth = glm::length(getGlobalAABB().center - lodSelection.cameraPosition);
+			for (auto&& mesh : pModel->meshes)
+				queue.push(ourShader, mesh, transform.getModelMatrix(), lod, depth);
+			stats.trianglesFullDetail += pModel->GetTriangleCount(0);
+			stats.display++;
+		}
+		stats.total++;
+
+		for (auto&& child : children)
+		{
+			child->enqueueSelfAndChild(frustum, ourShader, lodSelection, queue, stats);
+		}
+	}
+
+	//Cull the scene graph into the queue, then draw it sorted. The queue belongs to the caller, who keeps it across
+	//frames so its buffers are reused
+	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, const LodSelection& lodSelection, RenderQueue& queue, DrawStatistics& stats)
+	{
+		queue.begin(frustum, lodSelection.cameraPosition);
+		enqueueSelfAndChild(frustum, ourShader, lodSelection, queue, stats);
+		queue.sort();
+		queue.submit();
+		const RenderQueueStatistics& queueStats = queue.getStatistics();
+		stats.triangles += queueStats.triangles;
+		stats.clustersTested += queueStats.clustersTested;
+		stats.clustersVisible += queueStats.clustersVisible;
+		stats.programChanges += queueStats.programChanges;
+		stats.materialChanges += queueStats.materialChanges;
+		stats.meshChanges += queueStats.meshChanges;
+	}
+
 	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total)
 	{
 		if (boundingVolume->isOnFrustum(frustum, transform))
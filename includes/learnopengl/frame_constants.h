@@ -0,0 +1,119 @@
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+#include <learnopengl/camera.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader_source.h>
+#include <learnopengl/std140.h>
+#include <learnopengl/uniform_table.h>
+
+// values every program needs once per frame, laid out exactly like the std140 block below so it is uploaded as is
+struct FrameConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 cameraPosition;
+    float time;              // fills the 4 bytes std140 leaves after the vec3
+    glm::vec2 viewportSize;  // in pixels
+    float deltaTime;
+    float padding;           // std140 rounds blocks up to 16 bytes
+};
+
+STD140_MEMBER(FrameConstants, view, projection);
+STD140_MEMBER(FrameConstants, projection, viewProjection);
+STD140_MEMBER(FrameConstants, viewProjection, cameraPosition);
+STD140_MEMBER(FrameConstants, cameraPosition, time);
+STD140_MEMBER(FrameConstants, time, viewportSize);
+STD140_MEMBER(FrameConstants, viewportSize, deltaTime);
+static_assert(offsetof(FrameConstants, view) == 0 && sizeof(FrameConstants) == 224, "FrameConstants doesn't match its std140 block");
+
+// the FrameConstants of the current frame in one uniform buffer, bound to kBinding for every program. Instead of
+// setting view, projection and camera uniforms on each program, shaders declare the block with
+//     #include "frame_constants.glsl"
+// and read frame.view, frame.projection, ..., and update() uploads the values once a frame, however many programs
+// there are. Create it before building the shaders that use the block, as that is when their binding is set
+class FrameUniforms
+{
+public:
+    static constexpr GLuint kBinding = 0;
+
+    static constexpr const char *kSource =
+        "layout(std140) uniform FrameConstants\n"
+        "{\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "    mat4 viewProjection;\n"
+        "    vec3 cameraPosition;\n"
+        "    float time;\n"
+        "    vec2 viewportSize;\n"
+        "    float deltaTime;\n"
+        "} frame;\n";
+
+    FrameUniforms()
+    {
+        ShaderSource::addFile("frame_constants.glsl", kSource);
+        UniformTable::setBlockBinding("FrameConstants", kBinding);
+        glGenBuffers(1, &buffer);
+        GLState::bindBufferBase(GL_UNIFORM_BUFFER, kBinding, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    ~FrameUniforms()
+    {
+        glDeleteBuffers(1, &buffer);
+        GLState::forgetBuffer(buffer);
+    }
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    // uploads the frame's values, once before the frame's first draw
+    void update(const FrameConstants &frame)
+    {
+        constants = frame;
+        GLState::bindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+    }
+
+    void update(Camera &camera, const glm::mat4 &projection, float time, float deltaTime, float width, float height)
+    {
+        FrameConstants frame;
+        frame.view = camera.GetViewMatrix();
+        frame.projection = projection;
+        frame.viewProjection = projection * frame.view;
+        frame.cameraPosition = camera.Position;
+        frame.time = time;
+        frame.viewportSize = glm::vec2(width, height);
+        frame.deltaTime = deltaTime;
+        frame.padding = 0.0f;
+        update(frame);
+    }
+
+    const FrameConstants& current() const
+    {
+        return constants;
+    }
+
+    // whether the driver laid out program's FrameConstants block like the struct; for debug builds
+    static bool check(GLuint program)
+    {
+        return checkStd140Block(program, "FrameConstants", sizeof(FrameConstants), {
+            { "FrameConstants.view", offsetof(FrameConstants, view) },
+            { "FrameConstants.projection", offsetof(FrameConstants, projection) },
+            { "FrameConstants.viewProjection", offsetof(FrameConstants, viewProjection) },
+            { "FrameConstants.cameraPosition", offsetof(FrameConstants, cameraPosition) },
+            { "FrameConstants.time", offsetof(FrameConstants, time) },
+            { "FrameConstants.viewportSize", offsetof(FrameConstants, viewportSize) },
+            { "FrameConstants.deltaTime", offsetof(FrameConstants, deltaTime) } });
+    }
+
+private:
+    GLuint buffer = 0;
+    FrameConstants constants;
+};
+#endif
@@ -0,0 +1,312 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// counts of one frame's state changes, see GLState::endFrame()
+struct GLStateStatistics {
+    unsigned long long issued = 0;
+    unsigned long long filtered = 0; // the state was already set, no GL call was made
+};
+
+// the binding and fixed function state that draws change most, as last set through here, so that setting what is
+// already set issues no GL call: the program in use, the vertex array, the buffer bound to each common target, the
+// active texture unit with the 2D texture and sampler of each unit, and blending and depth state. Everything in
+// learnopengl and the demos goes through this class; code that calls the GL functions for this state itself has to
+// call invalidate() afterwards. State not set through here yet counts as unknown, so its first set always reaches GL.
+// the element array buffer belongs to the vertex array, so it is forgotten whenever the vertex array changes. Editing a
+// texture (uploads, parameters) binds it on unit 0 with bindTextureForUpdate(), which leaves unit 0 active
+class GLState
+{
+public:
+    static constexpr GLuint kTextureUnits = 32;
+
+    static void useProgram(GLuint program)
+    {
+        if (filter(instance().program, program))
+            glUseProgram(program);
+    }
+
+    static void bindVertexArray(GLuint vertexArray)
+    {
+        State &state = instance();
+        if (!filter(state.vertexArray, vertexArray))
+            return;
+        glBindVertexArray(vertexArray);
+        state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+    }
+
+    // targets other than the common ones aren't tracked and always bind
+    static void bindBuffer(GLenum target, GLuint buffer)
+    {
+        const int slot = bufferSlot(target);
+        if (slot < 0)
+            count(true);
+        if (slot < 0 || filter(instance().buffers[slot], buffer))
+            glBindBuffer(target, buffer);
+    }
+
+    // an indexed binding point, which also binds the buffer to the generic target like GL does
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        glBindBufferBase(target, index, buffer);
+        count(true);
+        const int slot = bufferSlot(target);
+        if (slot >= 0)
+            instance().buffers[slot] = buffer;
+    }
+
+    // makes unit active, then binds texture to target there; each step only when it isn't so already.
+    // targets other than GL_TEXTURE_2D aren't tracked and always bind
+    static void bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        if (target == GL_TEXTURE_2D && unit < kTextureUnits && instance().textures[unit] == texture)
+        {
+            count(false);
+            return;
+        }
+        activeTexture(unit);
+        bindOnActiveUnit(target, texture);
+    }
+
+    static void bindTextureForUpdate(GLenum target, GLuint texture)
+    {
+        activeTexture(0);
+        if (target == GL_TEXTURE_2D && instance().textures[0] == texture)
+            count(false);
+        else
+            bindOnActiveUnit(target, texture);
+    }
+
+    static void activeTexture(GLuint unit)
+    {
+        if (filter(instance().activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    static void bindSampler(GLuint unit, GLuint sampler)
+    {
+        if (unit >= kTextureUnits)
+        {
+            glBindSampler(unit, sampler);
+            count(true);
+        }
+        else if (filter(instance().samplers[unit], sampler))
+            glBindSampler(unit, sampler);
+    }
+
+    // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE and GL_SCISSOR_TEST are tracked, other capabilities always go through
+    static void setEnabled(GLenum capability, bool enabled)
+    {
+        const int slot = capabilitySlot(capability);
+        if (slot < 0)
+            count(true);
+        if (slot < 0 || filter(instance().capabilities[slot], enabled ? 1u : 0u))
+            enabled ? glEnable(capability) : glDisable(capability);
+    }
+
+    static void enable(GLenum capability)
+    {
+        setEnabled(capability, true);
+    }
+
+    static void disable(GLenum capability)
+    {
+        setEnabled(capability, false);
+    }
+
+    static void blendFunc(GLenum source, GLenum destination)
+    {
+        State &state = instance();
+        if (state.blendSource == source && state.blendDestination == destination)
+        {
+            count(false);
+            return;
+        }
+        glBlendFunc(source, destination);
+        count(true);
+        state.blendSource = source;
+        state.blendDestination = destination;
+    }
+
+    static void depthFunc(GLenum function)
+    {
+        if (filter(instance().depthFunction, function))
+            glDepthFunc(function);
+    }
+
+    static void depthMask(bool write)
+    {
+        if (filter(instance().depthWrite, write ? 1u : 0u))
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+
+    // deleting an object unbinds it wherever it is bound; call with the names just passed to glDelete*.
+    // a deleted program stays in use until another one is, but its name may come back for a new program
+    static void forgetProgram(GLuint program)
+    {
+        State &state = instance();
+        if (state.program == program)
+            state.program = kUnknown;
+    }
+
+    static void forgetVertexArray(GLuint vertexArray)
+    {
+        State &state = instance();
+        if (state.vertexArray == vertexArray)
+        {
+            state.vertexArray = 0;
+            state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+        }
+    }
+
+    static void forgetBuffer(GLuint buffer)
+    {
+        for (GLuint &bound : instance().buffers)
+            if (bound == buffer)
+                bound = 0;
+    }
+
+    static void forgetTexture(GLuint texture)
+    {
+        State &state = instance();
+        for (GLuint &bound : state.textures)
+            if (bound == texture)
+                bound = 0;
+    }
+
+    // forget everything, the next set of each state goes to GL
+    static void invalidate()
+    {
+        State &state = instance();
+        State fresh;
+        fresh.textureChanges = state.textureChanges + 1;
+        fresh.frameStatistics = state.frameStatistics;
+        fresh.lastFrameStatistics = state.lastFrameStatistics;
+        state = fresh;
+    }
+
+    // grows whenever a unit's texture may have changed; equal values mean the units still hold what they held
+    static unsigned long long textureGeneration()
+    {
+        return instance().textureChanges;
+    }
+
+    // counts of the last finished frame
+    static GLStateStatistics getStatistics()
+    {
+        return instance().lastFrameStatistics;
+    }
+
+    // call once per frame: closes the frame's counts for getStatistics() and starts counting the next one
+    static void endFrame()
+    {
+        State &state = instance();
+        state.lastFrameStatistics = state.frameStatistics;
+        state.frameStatistics = GLStateStatistics();
+    }
+
+    static void report(std::ostream &out = std::cout)
+    {
+        const GLStateStatistics statistics = getStatistics();
+        out << "GL_STATE:: " << statistics.issued << " state calls issued, " << statistics.filtered << " filtered as redundant" << std::endl;
+    }
+
+private:
+    static constexpr GLuint kUnknown = ~0u;
+    static constexpr int kBufferTargets = 6;
+    static constexpr int kCapabilities = 4;
+
+    struct State {
+        GLuint program = kUnknown;
+        GLuint vertexArray = kUnknown;
+        GLuint buffers[kBufferTargets];
+        GLuint activeUnit = kUnknown;
+        GLuint textures[kTextureUnits];
+        GLuint samplers[kTextureUnits];
+        GLuint capabilities[kCapabilities];
+        GLenum blendSource = kUnknown;
+        GLenum blendDestination = kUnknown;
+        GLenum depthFunction = kUnknown;
+        GLuint depthWrite = kUnknown;
+        unsigned long long textureChanges = 0;
+        GLStateStatistics frameStatistics;
+        GLStateStatistics lastFrameStatistics;
+
+        State()
+        {
+            for (GLuint &bound : buffers)
+                bound = kUnknown;
+            for (GLuint &bound : textures)
+                bound = kUnknown;
+            for (GLuint &bound : samplers)
+                bound = kUnknown;
+            for (GLuint &enabled : capabilities)
+                enabled = kUnknown;
+        }
+    };
+
+    static State& instance()
+    {
+        static State state;
+        return state;
+    }
+
+    static void count(bool issued)
+    {
+        GLStateStatistics &statistics = instance().frameStatistics;
+        issued ? statistics.issued++ : statistics.filtered++;
+    }
+
+    static void bindOnActiveUnit(GLenum target, GLuint texture)
+    {
+        State &state = instance();
+        glBindTexture(target, texture);
+        count(true);
+        state.textureChanges++;
+        if (target == GL_TEXTURE_2D && state.activeUnit < kTextureUnits)
+            state.textures[state.activeUnit] = texture;
+    }
+
+    // records value and returns true when it differs from current, i.e. when the GL call has to be made
+    static bool filter(GLuint &current, GLuint value)
+    {
+        if (current == value)
+        {
+            count(false);
+            return false;
+        }
+        current = value;
+        count(true);
+        return true;
+    }
+
+    static int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:         return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER:       return 2;
+        case GL_PIXEL_UNPACK_BUFFER:  return 3;
+        case GL_COPY_READ_BUFFER:     return 4;
+        case GL_COPY_WRITE_BUFFER:    return 5;
+        default:                      return -1;
+        }
+    }
+
+    static int capabilitySlot(GLenum capability)
+    {
+        switch (capability)
+        {
+        case GL_BLEND:        return 0;
+        case GL_DEPTH_TEST:   return 1;
+        case GL_CULL_FACE:    return 2;
+        case GL_SCISSOR_TEST: return 3;
+        default:              return -1;
+        }
+    }
+};
+#endif
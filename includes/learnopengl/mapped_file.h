@@ -0,0 +1,163 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// read-only view of a whole file. The file is memory mapped, so decoders read it straight from the page cache with no
+// copy into a buffer of our own; where mapping fails (special files, odd file systems) it is read into memory instead.
+// an empty or missing file gives an empty view
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const string &filename)
+    {
+        open(filename);
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+    MappedFile& operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            bytes = other.bytes;
+            length = other.length;
+            mapping = other.mapping;
+            copy = std::move(other.copy);
+            other.bytes = nullptr;
+            other.length = 0;
+            other.mapping = false;
+        }
+        return *this;
+    }
+
+    bool open(const string &filename)
+    {
+        close();
+        if (map(filename))
+            return true;
+
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        copy.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(copy.data()), static_cast<std::streamsize>(copy.size()));
+        bytes = copy.data();
+        length = copy.size();
+        return length > 0;
+    }
+
+    void close()
+    {
+        if (mapping)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(bytes);
+#else
+            munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+        }
+        bytes = nullptr;
+        length = 0;
+        mapping = false;
+        copy.clear();
+        copy.shrink_to_fit();
+    }
+
+    const unsigned char* data() const
+    {
+        return bytes;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    bool empty() const
+    {
+        return length == 0;
+    }
+
+    // true when the view is a mapping rather than a copy
+    bool mapped() const
+    {
+        return mapping;
+    }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+    bool mapping = false;
+    vector<unsigned char> copy;
+
+    bool map(const string &filename)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        HANDLE section = nullptr;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+            section = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!section)
+            return false;
+        void *view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(section); // the view keeps the mapping alive
+        if (!view)
+            return false;
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = ::open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat status;
+        void *view = MAP_FAILED;
+        if (fstat(file, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0)
+            view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file); // the mapping keeps the file alive
+        if (view == MAP_FAILED)
+            return false;
+        length = static_cast<size_t>(status.st_size);
+        // decoders read front to back, so let the kernel read ahead
+        madvise(view, length, MADV_SEQUENTIAL);
+#endif
+        bytes = static_cast<const unsigned char*>(view);
+        mapping = true;
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,136 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/uniform_table.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Texture {
+    unsigned int id;
+    string type;
+    string path;
+};
+
+// one texture of a material: the sampler uniform it feeds, the unit it sits on and the texture itself
+struct MaterialBinding {
+    UniformId sampler;
+    GLint unit;
+    GLuint texture;
+};
+
+// the textures of a mesh resolved once at load: texture_diffuseN style sampler names, units 0..n-1 in the order of the
+// textures, and a sort key. Materials with the same textures in the same order share their key, so bind() skips
+// everything when the previous material bound to the same program had that key and no unit changed since
+class Material
+{
+public:
+    Material() = default;
+
+    explicit Material(const vector<Texture> &textures)
+    {
+        unsigned int diffuseNr  = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr   = 1;
+        unsigned int heightNr   = 1;
+        vector<GLuint> names;
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            // retrieve texture number (the N in diffuse_textureN)
+            unsigned int number = 0;
+            const string &name = textures[i].type;
+            if (name == "texture_diffuse")
+                number = diffuseNr++;
+            else if (name == "texture_specular")
+                number = specularNr++;
+            else if (name == "texture_normal")
+                number = normalNr++;
+            else if (name == "texture_height")
+                number = heightNr++;
+
+            const UniformId sampler(name);
+            bindings.push_back({ number ? sampler.withNumber(number) : sampler, static_cast<GLint>(i), textures[i].id });
+            names.push_back(textures[i].id);
+            names.push_back(sampler.hash);
+        }
+        key = intern(names);
+    }
+
+    // small and dense: 0 for no textures, then 1, 2, ... in the order distinct texture sets were first seen
+    uint32_t sortKey() const
+    {
+        return key;
+    }
+
+    const vector<MaterialBinding>& getBindings() const
+    {
+        return bindings;
+    }
+
+    // points the program's samplers at the material's units and binds its textures there. Units already holding the
+    // right texture aren't rebound; the shader's shadow values filter unchanged samplers
+    template <class ShaderType>
+    void bind(ShaderType &shader) const
+    {
+        Bound &last = bound();
+        if (last.key == key && last.program == shader.ID && last.generation == GLState::textureGeneration())
+            return;
+        for (const MaterialBinding &binding : bindings)
+        {
+            shader.setInt(binding.sampler, binding.unit);
+            GLState::bindTexture(binding.unit, GL_TEXTURE_2D, binding.texture);
+        }
+        last.key = key;
+        last.program = shader.ID;
+        last.generation = GLState::textureGeneration();
+    }
+
+    // makes the next bind() go through, e.g. after a sampler uniform was set behind the material's back
+    static void invalidate()
+    {
+        bound().program = 0;
+    }
+
+    // distinct texture sets seen so far
+    static unsigned int count()
+    {
+        return static_cast<unsigned int>(keys().size());
+    }
+
+private:
+    vector<MaterialBinding> bindings;
+    uint32_t key = 0;
+
+    struct Bound {
+        uint32_t key = 0;
+        GLuint program = 0;
+        unsigned long long generation = 0;
+    };
+
+    static Bound& bound()
+    {
+        static Bound last;
+        return last;
+    }
+
+    static map<vector<GLuint>, uint32_t>& keys()
+    {
+        static map<vector<GLuint>, uint32_t> known;
+        return known;
+    }
+
+    static uint32_t intern(const vector<GLuint> &names)
+    {
+        if (names.empty())
+            return 0;
+        auto found = keys().emplace(names, static_cast<uint32_t>(keys().size() + 1));
+        return found.first->second;
+    }
+};
+#endif
@@ -6,8 +6,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/gl_state.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/material.h>
+#include <learnopengl/mesh_cluster.h>
+#include <learnopengl/upload_queue.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 using namespace std;
@@ -31,72 +37,211 @@ struct Vertex {
 	float m_Weights[MAX_BONE_INFLUENCE];
 };
 
-struct Texture {
-    unsigned int id;
-    string type;
-    string path;
+// one level of detail of a mesh: a range of the mesh's index buffer. All levels share the vertex buffer.
+struct MeshLod {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    float error = 0.0f; // geometric deviation from the full mesh, relative to the mesh extent
+};
+
+// which CPU-side consumers still need a mesh's vertex and index data once it lives on the GPU.
+// with MESH_CPU_DATA_NONE the arrays are released right after upload; bounds, LODs and clusters are computed before that.
+enum MeshCpuDataUsage {
+    MESH_CPU_DATA_NONE     = 0,
+    MESH_CPU_DATA_BOUNDS   = 1 << 0, // recomputing exact bounds later, e.g. after editing vertices
+    MESH_CPU_DATA_PICKING  = 1 << 1, // ray/triangle picking
+    MESH_CPU_DATA_SKINNING = 1 << 2  // CPU skinning or skinned bounds
 };
 
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, empty after upload unless cpuDataUsage asks to keep it
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    Material             material; // the textures' sampler units, resolved once
+    vector<MeshLod>      lods; // index ranges of each level of detail, lods[0] is the full mesh
+    vector<MeshCluster>  clusters; // culling clusters over lods[0], empty for small meshes
+    unsigned int VAO = 0;
+    // GL_UNSIGNED_SHORT when the mesh has fewer than 65536 vertices, GL_UNSIGNED_INT otherwise
+    GLenum indexType = GL_UNSIGNED_INT;
+    // model space bounds, always available even after the vertices are released
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    unsigned int cpuDataUsage = MESH_CPU_DATA_NONE;
+    // texture coordinate units per model space unit, averaged over the surface; turns on-screen size into texture resolution
+    float uvDensity = 0.0f;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes ownership of the mesh data: pass the vectors with std::move to avoid copying them.
+    // with an upload queue the buffer contents are streamed in over the next frames and the mesh draws nothing until they are
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<MeshLod> lods = vector<MeshLod>(), vector<MeshCluster> clusters = vector<MeshCluster>(), unsigned int cpuDataUsage = MESH_CPU_DATA_NONE, UploadQueue *uploads = nullptr)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), material(this->textures), lods(std::move(lods)), clusters(std::move(clusters)), cpuDataUsage(cpuDataUsage), uploads(uploads)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        // without a LOD chain the whole index buffer is the only level
+        if (this->lods.empty())
+        {
+            MeshLod full;
+            full.indexCount = static_cast<unsigned int>(this->indices.size());
+            this->lods.push_back(full);
+        }
+        computeBounds();
+        computeUvDensity();
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
+
+        // the GPU has its own copy now; drop ours unless something on the CPU still reads it
+        if (this->cpuDataUsage == MESH_CPU_DATA_NONE)
+            releaseCpuData();
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // a mesh owns its GL objects, so it can be moved but not copied
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        *this = std::move(other);
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept
+    {
+        if (this != &other)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            deleteBuffers();
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            textures = std::move(other.textures);
+            material = std::move(other.material);
+            lods = std::move(other.lods);
+            clusters = std::move(other.clusters);
+            VAO = other.VAO;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            indexType = other.indexType;
+            boundsMin = other.boundsMin;
+            boundsMax = other.boundsMax;
+            uvDensity = other.uvDensity;
+            cpuDataUsage = other.cpuDataUsage;
+            uploads = other.uploads;
+            uploadTicket = other.uploadTicket;
+            other.VAO = other.VBO = other.EBO = 0;
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        return *this;
+    }
+
+    ~Mesh()
+    {
+        deleteBuffers();
+    }
+
+    bool hasCpuData() const
+    {
+        return !vertices.empty();
+    }
+
+    // false while the buffer contents are still queued for upload
+    bool isResident()
+    {
+        if (uploads && uploads->isComplete(uploadTicket))
+            uploads = nullptr;
+        return uploads == nullptr;
+    }
+
+    // frees the CPU copies of the vertex and index data; the mesh keeps drawing from its GPU buffers
+    void releaseCpuData()
+    {
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+    }
+
+    // render the mesh at the given level of detail (clamped to the coarsest available), returns the number of triangles submitted.
+    // with culling information the full detail level only draws the clusters that are in the frustum and not backfacing.
+    // ShaderType is any of the Shader classes, or whatever has their ID and setInt(), such as the RenderQueue's programs
+    template <class ShaderType>
+    unsigned int Draw(ShaderType &shader, unsigned int lod = 0, ClusterCulling *culling = nullptr)
+    {
+        if (!isResident())
+            return 0;
+
+        // bind appropriate textures, nothing when the previous mesh had the same ones
+        material.bind(shader);
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        // draw mesh
+        const MeshLod &range = lods[std::min<size_t>(lod, lods.size() - 1)];
+        const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        unsigned int triangles = range.indexCount / 3;
+        // the vertex array stays bound, so the next draw of this mesh or a later one on the same buffers skips the bind
+        GLState::bindVertexArray(VAO);
+        if (culling && lod == 0 && !clusters.empty())
+        {
+            MeshClusterizer::cull(clusters, *culling, indexSize, clusterCounts, clusterOffsets);
+            triangles = 0;
+            for (size_t i = 0; i < clusterCounts.size(); i++)
+                triangles += clusterCounts[i] / 3;
+            if (!clusterCounts.empty())
+                glMultiDrawElements(GL_TRIANGLES, clusterCounts.data(), indexType, clusterOffsets.data(), static_cast<GLsizei>(clusterCounts.size()));
+        }
+        else
+            glDrawElements(GL_TRIANGLES, range.indexCount, indexType, (void*)(range.indexOffset * indexSize));
+        return triangles;
     }
 
 private:
     // render data 
-    unsigned int VBO, EBO;
+    unsigned int VBO = 0, EBO = 0;
+    // set while the buffers are being streamed in; the queue must outlive that
+    UploadQueue *uploads = nullptr;
+    unsigned long long uploadTicket = 0;
+    // scratch ranges for multi-draw of the visible clusters, kept to avoid reallocating every frame
+    vector<GLsizei> clusterCounts;
+    vector<const void*> clusterOffsets;
+
+    void computeBounds()
+    {
+        if (vertices.empty())
+            return;
+        boundsMin = boundsMax = vertices[0].Position;
+        for (size_t i = 1; i < vertices.size(); i++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[i].Position);
+            boundsMax = glm::max(boundsMax, vertices[i].Position);
+        }
+    }
+
+    // sqrt(UV area / surface area) over the full detail triangles
+    void computeUvDensity()
+    {
+        float surfaceArea = 0.0f, uvArea = 0.0f;
+        for (size_t i = 0; i + 2 < indices.size() && i + 2 < lods[0].indexCount; i += 3)
+        {
+            const Vertex &v0 = vertices[indices[i]], &v1 = vertices[indices[i + 1]], &v2 = vertices[indices[i + 2]];
+            surfaceArea += glm::length(glm::cross(v1.Position - v0.Position, v2.Position - v0.Position));
+            const glm::vec2 e1 = v1.TexCoords - v0.TexCoords, e2 = v2.TexCoords - v0.TexCoords;
+            uvArea += std::abs(e1.x * e2.y - e1.y * e2.x);
+        }
+        uvDensity = surfaceArea > 0.0f ? std::sqrt(uvArea / surfaceArea) : 0.0f;
+    }
+
+    void deleteBuffers()
+    {
+        if (VAO != 0)
+        {
+            glDeleteVertexArrays(1, &VAO);
+            GLState::forgetVertexArray(VAO);
+        }
+        if (VBO != 0)
+        {
+            glDeleteBuffers(1, &VBO);
+            GLState::forgetBuffer(VBO);
+        }
+        if (EBO != 0)
+        {
+            glDeleteBuffers(1, &EBO);
+            GLState::forgetBuffer(EBO);
+        }
+        VAO = VBO = EBO = 0;
+    }
 
     // initializes all the buffer objects/arrays
     void setupMesh()
@@ -106,16 +251,35 @@ private:
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        // When streaming, the buffers are only allocated here and the queue fills them later from its own copy of the data.
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), uploads ? nullptr : &vertices[0], GL_STATIC_DRAW);  
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        // 16-bit indices halve the index buffer size and fetch bandwidth whenever every index fits
+        if (vertices.size() < 65536)
+        {
+            vector<unsigned short> shortIndices(indices.begin(), indices.end());
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), uploads ? nullptr : shortIndices.data(), GL_STATIC_DRAW);
+            if (uploads)
+                uploadTicket = uploads->enqueueBuffer(EBO, 0, std::move(shortIndices));
+        }
+        else
+        {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), uploads ? nullptr : &indices[0], GL_STATIC_DRAW);
+            if (uploads)
+                uploadTicket = uploads->enqueueBuffer(EBO, 0, cpuDataUsage == MESH_CPU_DATA_NONE ? std::move(indices) : indices);
+        }
+        // the vertices go last so the ticket of the final request covers both buffers
+        if (uploads)
+            uploadTicket = std::max(uploadTicket, uploads->enqueueBuffer(VBO, 0, cpuDataUsage == MESH_CPU_DATA_NONE ? std::move(vertices) : vertices));
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -140,7 +304,8 @@ private:
 		// weights
 		glEnableVertexAttribArray(6);
 		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        // unbound, so buffer binds elsewhere can't change this mesh's element buffer
+        GLState::bindVertexArray(0);
     }
 };
 #endif
@@ -0,0 +1,212 @@
+#ifndef MESH_CLUSTER_H
+#define MESH_CLUSTER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+using namespace std;
+
+// a small, contiguous range of a mesh's index buffer with bounds for per-frame culling.
+// the normal cone follows meshoptimizer's convention: the cluster is entirely backfacing when
+// dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff.
+struct MeshCluster {
+    unsigned int indexOffset = 0;
+    unsigned int indexCount = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneApex = glm::vec3(0.0f);
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 2.0f; // > 1 means the cone is too wide to ever be culled
+};
+
+// per-draw culling input in world space, plus counters of what survived
+struct ClusterCulling {
+    Frustum frustum;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::mat4 model = glm::mat4(1.0f);
+    unsigned int clustersTested = 0;
+    unsigned int clustersVisible = 0;
+};
+
+// splits a mesh at load time into clusters of at most kMaxVertices unique vertices and kMaxTriangles triangles.
+// triangles are taken in index buffer order, which after vertex cache optimization is spatially coherent,
+// so every cluster stays a contiguous sub-range of the existing index buffer and needs no extra memory on the GPU.
+class MeshClusterizer
+{
+public:
+    static const unsigned int kMaxVertices = 64;
+    static const unsigned int kMaxTriangles = 124;
+    // meshes below this size are cheaper to draw whole than to cull
+    static const unsigned int kMinTriangles = 4 * kMaxTriangles;
+
+    // builds clusters over indices[indexOffset, indexOffset + indexCount); TVertex needs a glm::vec3 Position member
+    template <typename TVertex>
+    static vector<MeshCluster> build(const vector<TVertex> &vertices, const vector<unsigned int> &indices, unsigned int indexOffset, unsigned int indexCount)
+    {
+        vector<MeshCluster> clusters;
+        if (indexCount / 3 < kMinTriangles)
+            return clusters;
+
+        vector<unsigned int> lastCluster(vertices.size(), ~0u);
+        unsigned int clusterVertices = 0;
+        MeshCluster cluster;
+        cluster.indexOffset = indexOffset;
+
+        for (unsigned int i = indexOffset; i < indexOffset + indexCount; i += 3)
+        {
+            const unsigned int id = static_cast<unsigned int>(clusters.size());
+            unsigned int newVertices = 0;
+            for (int k = 0; k < 3; k++)
+                if (lastCluster[indices[i + k]] != id)
+                    newVertices++;
+
+            if (clusterVertices + newVertices > kMaxVertices || cluster.indexCount / 3 == kMaxTriangles)
+            {
+                computeBounds(cluster, vertices, indices);
+                clusters.push_back(cluster);
+                cluster = MeshCluster();
+                cluster.indexOffset = i;
+                clusterVertices = 0;
+                i -= 3; // retry this triangle in the new cluster
+                continue;
+            }
+
+            for (int k = 0; k < 3; k++)
+            {
+                if (lastCluster[indices[i + k]] != id)
+                {
+                    lastCluster[indices[i + k]] = id;
+                    clusterVertices++;
+                }
+            }
+            cluster.indexCount += 3;
+        }
+        if (cluster.indexCount > 0)
+        {
+            computeBounds(cluster, vertices, indices);
+            clusters.push_back(cluster);
+        }
+        return clusters;
+    }
+
+    // frustum and backface cone test of one cluster, done in world space. normalMatrix is the inverse transpose of the
+    // model matrix, which keeps the cone axis perpendicular to the faces under non-uniform scale
+    static bool isVisible(const MeshCluster &cluster, ClusterCulling &culling, float maxScale, const glm::mat3 &normalMatrix)
+    {
+        const glm::vec3 center(culling.model * glm::vec4(cluster.center, 1.0f));
+        if (!culling.frustum.isSphereOnFrustum(center, cluster.radius * maxScale))
+            return false;
+        if (cluster.coneCutoff > 1.0f)
+            return true;
+
+        const glm::vec3 apex(culling.model * glm::vec4(cluster.coneApex, 1.0f));
+        const glm::vec3 axis = glm::normalize(normalMatrix * cluster.coneAxis);
+        const glm::vec3 view = apex - culling.cameraPosition;
+        const float viewLength = glm::length(view);
+        return viewLength <= 0.0f || glm::dot(view / viewLength, axis) < cluster.coneCutoff;
+    }
+
+    // culls the clusters and writes the surviving index ranges for glMultiDrawElements; adjacent survivors are merged into one range
+    static void cull(const vector<MeshCluster> &clusters, ClusterCulling &culling, size_t indexSize, vector<GLsizei> &counts, vector<const void *> &offsets)
+    {
+        counts.clear();
+        offsets.clear();
+        const float maxScale = std::max(std::max(glm::length(glm::vec3(culling.model[0])), glm::length(glm::vec3(culling.model[1]))), glm::length(glm::vec3(culling.model[2])));
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(culling.model)));
+
+        unsigned int rangeEnd = ~0u;
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            const MeshCluster &cluster = clusters[c];
+            culling.clustersTested++;
+            if (!isVisible(cluster, culling, maxScale, normalMatrix))
+                continue;
+            culling.clustersVisible++;
+
+            if (cluster.indexOffset == rangeEnd)
+                counts.back() += cluster.indexCount;
+            else
+            {
+                counts.push_back(cluster.indexCount);
+                offsets.push_back((const void *)(cluster.indexOffset * indexSize));
+            }
+            rangeEnd = cluster.indexOffset + cluster.indexCount;
+        }
+    }
+
+private:
+    template <typename TVertex>
+    static void computeBounds(MeshCluster &cluster, const vector<TVertex> &vertices, const vector<unsigned int> &indices)
+    {
+        const unsigned int begin = cluster.indexOffset, end = cluster.indexOffset + cluster.indexCount;
+
+        // bounding sphere around the box center
+        glm::vec3 minPosition(std::numeric_limits<float>::max()), maxPosition(-std::numeric_limits<float>::max());
+        for (unsigned int i = begin; i < end; i++)
+        {
+            minPosition = glm::min(minPosition, vertices[indices[i]].Position);
+            maxPosition = glm::max(maxPosition, vertices[indices[i]].Position);
+        }
+        cluster.center = (minPosition + maxPosition) * 0.5f;
+        cluster.radius = 0.0f;
+        for (unsigned int i = begin; i < end; i++)
+            cluster.radius = std::max(cluster.radius, glm::length(vertices[indices[i]].Position - cluster.center));
+
+        // normal cone: average face normal, opened wide enough to contain every face normal
+        glm::vec3 axis(0.0f);
+        for (unsigned int i = begin; i < end; i += 3)
+        {
+            glm::vec3 n = faceNormal(vertices, indices, i);
+            axis += n;
+        }
+        float axisLength = glm::length(axis);
+        if (axisLength <= 0.0f)
+            return;
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (unsigned int i = begin; i < end; i += 3)
+        {
+            glm::vec3 n = faceNormal(vertices, indices, i);
+            if (glm::length(n) > 0.0f)
+                minDot = std::min(minDot, glm::dot(n, axis));
+        }
+        // a cone of 90 degrees or more always contains a front facing triangle
+        if (minDot <= 0.1f)
+            return;
+
+        // move the apex back along the axis until it is behind every triangle plane
+        float maxT = 0.0f;
+        for (unsigned int i = begin; i < end; i += 3)
+        {
+            glm::vec3 n = faceNormal(vertices, indices, i);
+            float dn = glm::dot(axis, n);
+            if (dn <= 0.0f)
+                continue;
+            float dc = glm::dot(cluster.center - vertices[indices[i]].Position, n);
+            maxT = std::max(maxT, dc / dn);
+        }
+
+        cluster.coneAxis = axis;
+        cluster.coneApex = cluster.center - axis * maxT;
+        cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    template <typename TVertex>
+    static glm::vec3 faceNormal(const vector<TVertex> &vertices, const vector<unsigned int> &indices, unsigned int i)
+    {
+        const glm::vec3 &p0 = vertices[indices[i]].Position;
+        const glm::vec3 &p1 = vertices[indices[i + 1]].Position;
+        const glm::vec3 &p2 = vertices[indices[i + 2]].Position;
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(n);
+        return length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+};
+#endif
@@ -0,0 +1,582 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// post-transform vertex cache statistics of an index buffer.
+// ACMR (average cache miss ratio) is transformed vertices per triangle, ideally close to 0.5 for regular grids.
+// ATVR (average transformed vertex ratio) is transformed vertices per referenced vertex, ideally 1.0.
+struct VertexCacheStatistics {
+    unsigned int verticesTransformed = 0;
+    unsigned int verticesReferenced = 0; // distinct vertices the indices use, what ATVR is measured against
+    unsigned int triangles = 0;
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// tolerances for MeshOptimizer::weldVertices. Two vertices are merged when every attribute is within its epsilon;
+// bone influences must reference the same bones with weights within weightEpsilon so skinning is unchanged.
+struct WeldSettings {
+    bool enabled = true;
+    float positionEpsilon = 1e-6f;
+    float normalEpsilon = 1e-3f;   // also used for tangent and bitangent
+    float texCoordEpsilon = 1e-6f;
+    float weightEpsilon = 1e-3f;
+};
+
+// before/after numbers of a MeshOptimizer::optimize run, accumulated per model
+struct MeshOptimizationReport {
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+    unsigned int meshes = 0;
+    unsigned int meshes16Bit = 0;
+    unsigned int verticesIn = 0;     // as imported
+    unsigned int verticesWelded = 0; // after the weld pass
+    unsigned int verticesOut = 0;    // after dropping unreferenced vertices
+
+    void accumulate(const MeshOptimizationReport &other)
+    {
+        before.verticesTransformed += other.before.verticesTransformed;
+        before.verticesReferenced += other.before.verticesReferenced;
+        before.triangles += other.before.triangles;
+        after.verticesTransformed += other.after.verticesTransformed;
+        after.verticesReferenced += other.after.verticesReferenced;
+        after.triangles += other.after.triangles;
+        meshes += other.meshes;
+        meshes16Bit += other.meshes16Bit;
+        verticesIn += other.verticesIn;
+        verticesWelded += other.verticesWelded;
+        verticesOut += other.verticesOut;
+        // ratios are recomputed from the totals so they stay weighted by triangle/vertex count
+        before.acmr = before.triangles ? float(before.verticesTransformed) / before.triangles : 0.0f;
+        after.acmr = after.triangles ? float(after.verticesTransformed) / after.triangles : 0.0f;
+        before.atvr = before.verticesReferenced ? float(before.verticesTransformed) / before.verticesReferenced : 0.0f;
+        after.atvr = after.verticesReferenced ? float(after.verticesTransformed) / after.verticesReferenced : 0.0f;
+    }
+
+    void print(std::ostream &out = std::cout) const
+    {
+        out << "MESH_OPTIMIZER:: " << meshes << " meshes (" << meshes16Bit << " with 16-bit indices), "
+            << after.triangles << " triangles, vertices " << verticesIn << " -> " << verticesOut << "\n"
+            << "  weld removed " << (verticesIn - verticesWelded) << " vertices ("
+            << (verticesIn ? 100.0f * (verticesIn - verticesWelded) / verticesIn : 0.0f) << "%, "
+            << (size_t(verticesIn - verticesWelded) * sizeof(Vertex)) / 1024 << " KiB)\n"
+            << "  ACMR " << before.acmr << " -> " << after.acmr
+            << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+    }
+};
+
+// CPU-only index/vertex buffer passes that run once at load time:
+// 0. vertex welding, merging vertices whose attributes are identical within an epsilon and rebuilding the index buffer
+// 1. vertex cache optimization (Forsyth's linear-speed algorithm) to maximize post-transform cache reuse
+// 2. overdraw optimization, clustering the cache-optimized triangles and sorting clusters outside-in
+// 3. vertex fetch optimization, renumbering vertices in order of first use so fetches stay sequential
+// none of these touch OpenGL, so they can be run and verified without a context.
+class MeshOptimizer
+{
+public:
+    // FIFO cache size used for the ACMR/ATVR simulation; 16 is a conservative match for most desktop GPUs.
+    static const unsigned int kSimulatedCacheSize = 16;
+    // LRU cache size the Forsyth scoring function models.
+    static const unsigned int kForsythCacheSize = 32;
+    // width of the weld grid cells in position epsilons; wider cells mean fewer cells to search per vertex but more
+    // candidates in each
+    static const int kWeldCellScale = 4;
+
+    // runs all passes on a triangle list in place and returns before/after statistics
+    static MeshOptimizationReport optimize(vector<Vertex> &vertices, vector<unsigned int> &indices, const WeldSettings &weld = WeldSettings(), float overdrawThreshold = 1.05f)
+    {
+        MeshOptimizationReport report;
+        report.meshes = 1;
+        report.verticesIn = static_cast<unsigned int>(vertices.size());
+        report.before = analyzeVertexCache(indices, vertices.size());
+
+        if (weld.enabled)
+            weldVertices(vertices, indices, weld);
+        report.verticesWelded = static_cast<unsigned int>(vertices.size());
+
+        optimizeVertexCache(indices, vertices.size());
+        if (overdrawThreshold > 0.0f)
+            optimizeOverdraw(indices, vertices, overdrawThreshold);
+        optimizeVertexFetch(vertices, indices);
+
+        report.verticesOut = static_cast<unsigned int>(vertices.size());
+        report.after = analyzeVertexCache(indices, vertices.size());
+        report.meshes16Bit = vertices.size() < 65536 ? 1 : 0;
+        return report;
+    }
+
+    // merges vertices whose attributes match within the given tolerances and remaps the index buffer.
+    // candidates are found through a hash of the quantized position and its neighbouring cells, so the pass is linear in
+    // the vertex count wherever the mesh sits.
+    // returns the number of vertices removed.
+    static size_t weldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices, const WeldSettings &settings = WeldSettings())
+    {
+        const unsigned int none = ~0u;
+        vector<unsigned int> remap(vertices.size());
+        vector<Vertex> welded;
+        welded.reserve(vertices.size());
+        // bucket chains: first welded vertex per position cell, then next welded vertex in the same cell
+        std::unordered_map<uint64_t, unsigned int> buckets;
+        buckets.reserve(vertices.size());
+        vector<unsigned int> next;
+        next.reserve(vertices.size());
+
+        // with an epsilon, positions go into a grid of kWeldCellScale epsilon wide cells and every cell within epsilon of
+        // a vertex is searched, which is at most two per axis; without one, only the exact position can match
+        const double epsilon = settings.positionEpsilon > 0.0f ? settings.positionEpsilon : 0.0;
+        const double cellSize = epsilon * kWeldCellScale;
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Vertex &vertex = vertices[i];
+            unsigned int match = none;
+            int64_t low[3], high[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                low[axis] = cellSize > 0.0 ? gridCell(vertex.Position[axis] - epsilon, cellSize) : 0;
+                high[axis] = cellSize > 0.0 ? gridCell(vertex.Position[axis] + epsilon, cellSize) : 0;
+            }
+            for (int64_t x = low[0]; x <= high[0] && match == none; x++)
+                for (int64_t y = low[1]; y <= high[1] && match == none; y++)
+                    for (int64_t z = low[2]; z <= high[2] && match == none; z++)
+                    {
+                        auto bucket = buckets.find(cellSize > 0.0 ? hashCell(x, y, z) : hashPosition(vertex.Position));
+                        if (bucket == buckets.end())
+                            continue;
+                        for (unsigned int candidate = bucket->second; candidate != none; candidate = next[candidate])
+                        {
+                            if (verticesEqual(welded[candidate], vertex, settings))
+                            {
+                                match = candidate;
+                                break;
+                            }
+                        }
+                    }
+
+            if (match == none)
+            {
+                // a new vertex goes into the cell its own position falls in
+                const uint64_t key = cellSize > 0.0 ? hashCell(gridCell(vertex.Position.x, cellSize), gridCell(vertex.Position.y, cellSize), gridCell(vertex.Position.z, cellSize))
+                                                     : hashPosition(vertex.Position);
+                match = static_cast<unsigned int>(welded.size());
+                welded.push_back(vertex);
+                auto bucket = buckets.find(key);
+                if (bucket != buckets.end())
+                {
+                    next.push_back(bucket->second);
+                    bucket->second = match;
+                }
+                else
+                {
+                    next.push_back(none);
+                    buckets.emplace(key, match);
+                }
+            }
+            remap[i] = match;
+        }
+
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = remap[indices[i]];
+
+        size_t removed = vertices.size() - welded.size();
+        vertices.swap(welded);
+        vertices.shrink_to_fit();
+        return removed;
+    }
+
+    // simulates a FIFO post-transform cache over the index buffer
+    static VertexCacheStatistics analyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = kSimulatedCacheSize)
+    {
+        VertexCacheStatistics stats;
+        // timestamp of the last time each vertex entered the cache; a vertex is resident while it is within cacheSize insertions
+        vector<unsigned int> cacheTimestamps(vertexCount, 0);
+        unsigned int timestamp = cacheSize + 1;
+        vector<bool> seen(vertexCount, false);
+
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int index = indices[i];
+            if (timestamp - cacheTimestamps[index] > cacheSize)
+            {
+                cacheTimestamps[index] = timestamp++;
+                stats.verticesTransformed++;
+            }
+            if (!seen[index])
+            {
+                seen[index] = true;
+                stats.verticesReferenced++;
+            }
+        }
+
+        stats.triangles = static_cast<unsigned int>(indices.size() / 3);
+        stats.acmr = stats.triangles ? float(stats.verticesTransformed) / stats.triangles : 0.0f;
+        stats.atvr = stats.verticesReferenced ? float(stats.verticesTransformed) / stats.verticesReferenced : 0.0f;
+        return stats;
+    }
+
+    // reorders triangles for post-transform cache locality (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+    static void optimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // build vertex -> triangle adjacency
+        vector<unsigned int> remaining(vertexCount, 0);
+        for (size_t i = 0; i < indices.size(); i++)
+            remaining[indices[i]]++;
+
+        vector<unsigned int> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + remaining[v];
+
+        vector<unsigned int> adjacency(indices.size());
+        vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+
+        vector<int> cachePosition(vertexCount, -1);
+        vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = forsythScore(-1, remaining[v]);
+
+        vector<float> triangleScore(triangleCount);
+        vector<bool> emitted(triangleCount, false);
+        for (size_t t = 0; t < triangleCount; t++)
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+        vector<unsigned int> output;
+        output.reserve(indices.size());
+
+        vector<unsigned int> cache, newCache, evicted;
+        cache.reserve(kForsythCacheSize + 3);
+        newCache.reserve(kForsythCacheSize + 3);
+
+        size_t inputCursor = 0; // fallback: next triangle in input order that has not been emitted
+        size_t bestTriangle = 0;
+        float bestScore = -1.0f;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            if (triangleScore[t] > bestScore)
+            {
+                bestScore = triangleScore[t];
+                bestTriangle = t;
+            }
+        }
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            if (bestScore < 0.0f)
+            {
+                // no candidate left in the cache; continue from the first unemitted triangle
+                while (emitted[inputCursor])
+                    inputCursor++;
+                bestTriangle = inputCursor;
+            }
+
+            const unsigned int a = indices[bestTriangle * 3], b = indices[bestTriangle * 3 + 1], c = indices[bestTriangle * 3 + 2];
+            output.push_back(a);
+            output.push_back(b);
+            output.push_back(c);
+            emitted[bestTriangle] = true;
+
+            // drop the emitted triangle from its vertices' adjacency lists
+            const unsigned int triangleVertices[3] = { a, b, c };
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = triangleVertices[k];
+                unsigned int *list = &adjacency[offsets[v]];
+                for (unsigned int j = 0; j < remaining[v]; j++)
+                {
+                    if (list[j] == bestTriangle)
+                    {
+                        std::swap(list[j], list[remaining[v] - 1]);
+                        break;
+                    }
+                }
+                remaining[v]--;
+            }
+
+            // push the triangle's vertices to the front of the LRU cache
+            newCache.clear();
+            newCache.push_back(a);
+            newCache.push_back(b);
+            newCache.push_back(c);
+            for (size_t j = 0; j < cache.size(); j++)
+                if (cache[j] != a && cache[j] != b && cache[j] != c)
+                    newCache.push_back(cache[j]);
+
+            // vertices pushed out of the cache lose their position
+            evicted.clear();
+            for (size_t j = kForsythCacheSize; j < newCache.size(); j++)
+            {
+                cachePosition[newCache[j]] = -1;
+                evicted.push_back(newCache[j]);
+            }
+            if (newCache.size() > kForsythCacheSize)
+                newCache.resize(kForsythCacheSize);
+            cache.swap(newCache);
+
+            // rescore cached vertices and the triangles that still reference them, picking the next best triangle on the way
+            bestScore = -1.0f;
+            for (size_t j = 0; j < cache.size(); j++)
+            {
+                unsigned int v = cache[j];
+                cachePosition[v] = static_cast<int>(j);
+                float score = forsythScore(static_cast<int>(j), remaining[v]);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+
+                const unsigned int *list = &adjacency[offsets[v]];
+                for (unsigned int k = 0; k < remaining[v]; k++)
+                {
+                    unsigned int t = list[k];
+                    triangleScore[t] += delta;
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+            // vertices that were just evicted no longer contribute their cache bonus
+            for (size_t j = 0; j < evicted.size(); j++)
+            {
+                unsigned int v = evicted[j];
+                float score = forsythScore(-1, remaining[v]);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+                const unsigned int *list = &adjacency[offsets[v]];
+                for (unsigned int k = 0; k < remaining[v]; k++)
+                    triangleScore[list[k]] += delta;
+            }
+        }
+
+        indices.swap(output);
+    }
+
+    // splits the cache-optimized index buffer into clusters at cache-miss boundaries and orders the clusters
+    // so that outward facing geometry is drawn first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+    // a cluster boundary is only inserted where the running ACMR stays within threshold * ACMR of the whole mesh, so cache efficiency is kept.
+    static void optimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold = 1.05f)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+
+        const float meshAcmr = analyzeVertexCache(indices, vertices.size()).acmr;
+
+        // find cluster starts: hard boundaries are triangles where every vertex misses the cache,
+        // soft boundaries are accepted when the cluster so far is at least as cache-friendly as the whole mesh
+        vector<unsigned int> clusterStarts;
+        vector<unsigned int> cacheTimestamps(vertices.size(), 0);
+        unsigned int timestamp = kSimulatedCacheSize + 1;
+        unsigned int clusterMisses = 0, clusterTriangles = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            unsigned int misses = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int index = indices[t * 3 + k];
+                if (timestamp - cacheTimestamps[index] > kSimulatedCacheSize)
+                {
+                    cacheTimestamps[index] = timestamp++;
+                    misses++;
+                }
+            }
+
+            bool hardBoundary = misses == 3;
+            bool softBoundary = clusterTriangles > 0 && misses >= 2 && float(clusterMisses) / clusterTriangles <= meshAcmr * threshold;
+            if (t == 0 || hardBoundary || softBoundary)
+            {
+                clusterStarts.push_back(static_cast<unsigned int>(t));
+                clusterMisses = 0;
+                clusterTriangles = 0;
+            }
+            clusterMisses += misses;
+            clusterTriangles++;
+        }
+        if (clusterStarts.size() < 2)
+            return;
+
+        // mesh centroid, used as the reference point for the outward facing sort
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+            float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+            meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+            meshArea += area;
+        }
+        if (meshArea > 0.0f)
+            meshCentroid /= meshArea;
+
+        // sort clusters by how far their area weighted normal points away from the mesh centroid
+        vector<float> clusterSortKey(clusterStarts.size());
+        for (size_t c = 0; c < clusterStarts.size(); c++)
+        {
+            size_t begin = clusterStarts[c];
+            size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+            glm::vec3 centroid(0.0f), normal(0.0f);
+            float area = 0.0f;
+            for (size_t t = begin; t < end; t++)
+            {
+                const glm::vec3 &p0 = vertices[indices[t * 3]].Position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                float a = glm::length(n);
+                centroid += (p0 + p1 + p2) * (a / 3.0f);
+                normal += n;
+                area += a;
+            }
+            if (area > 0.0f)
+                centroid /= area;
+            float normalLength = glm::length(normal);
+            clusterSortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+        }
+
+        vector<unsigned int> order(clusterStarts.size());
+        for (size_t c = 0; c < order.size(); c++)
+            order[c] = static_cast<unsigned int>(c);
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int l, unsigned int r) { return clusterSortKey[l] > clusterSortKey[r]; });
+
+        vector<unsigned int> output;
+        output.reserve(indices.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            size_t c = order[i];
+            size_t begin = clusterStarts[c];
+            size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+            output.insert(output.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+        }
+        indices.swap(output);
+    }
+
+    // renumbers vertices in the order the index buffer first references them; unreferenced vertices are dropped
+    static void optimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        const unsigned int unused = ~0u;
+        vector<unsigned int> remap(vertices.size(), unused);
+        vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int &target = remap[indices[i]];
+            if (target == unused)
+            {
+                target = static_cast<unsigned int>(reordered.size());
+                reordered.push_back(vertices[indices[i]]);
+            }
+            indices[i] = target;
+        }
+        vertices.swap(reordered);
+    }
+
+private:
+    static bool nearlyEqual(const float *a, const float *b, int count, float epsilon)
+    {
+        for (int i = 0; i < count; i++)
+            if (std::fabs(a[i] - b[i]) > epsilon)
+                return false;
+        return true;
+    }
+
+    static bool verticesEqual(const Vertex &a, const Vertex &b, const WeldSettings &settings)
+    {
+        // skinning: the same bones must influence both vertices, with matching weights
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            if (a.m_BoneIDs[i] != b.m_BoneIDs[i])
+                return false;
+            if (std::fabs(a.m_Weights[i] - b.m_Weights[i]) > settings.weightEpsilon)
+                return false;
+        }
+        return nearlyEqual(&a.Position.x, &b.Position.x, 3, settings.positionEpsilon) &&
+               nearlyEqual(&a.TexCoords.x, &b.TexCoords.x, 2, settings.texCoordEpsilon) &&
+               nearlyEqual(&a.Normal.x, &b.Normal.x, 3, settings.normalEpsilon) &&
+               nearlyEqual(&a.Tangent.x, &b.Tangent.x, 3, settings.normalEpsilon) &&
+               nearlyEqual(&a.Bitangent.x, &b.Bitangent.x, 3, settings.normalEpsilon);
+    }
+
+    // the grid cell of a coordinate, computed in double and clamped so that huge coordinates or tiny epsilons can't
+    // overflow the integer; clamped coordinates share the outermost cells. NaN lands there too
+    static int64_t gridCell(double value, double cellSize)
+    {
+        const double limit = 4611686018427387904.0; // 2^62
+        double cell = std::floor(value / cellSize);
+        if (!(cell > -limit))
+            cell = -limit;
+        else if (cell > limit)
+            cell = limit;
+        return static_cast<int64_t>(cell);
+    }
+
+    static uint64_t hashCell(int64_t x, int64_t y, int64_t z)
+    {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        const uint64_t cell[3] = { static_cast<uint64_t>(x), static_cast<uint64_t>(y), static_cast<uint64_t>(z) };
+        for (int i = 0; i < 3; i++)
+            for (int b = 0; b < 8; b++)
+            {
+                hash ^= (cell[i] >> (b * 8)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+        return hash;
+    }
+
+    // hashes the exact bit pattern of the position, for welding without an epsilon
+    static uint64_t hashPosition(const glm::vec3 &position)
+    {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (int i = 0; i < 3; i++)
+        {
+            uint32_t bits;
+            float value = position[i] == 0.0f ? 0.0f : position[i]; // fold -0 into +0
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (int b = 0; b < 4; b++)
+            {
+                hash ^= (bits >> (b * 8)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+    // Forsyth's vertex score: recently used vertices and vertices with few remaining triangles are preferred
+    static float forsythScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // the three vertices of the last triangle get a fixed score so the next triangle isn't biased towards one of them
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / float(kForsythCacheSize - 3), 1.5f);
+        }
+        // boost vertices with few triangles left so lone triangles get finished off instead of left behind
+        score += 2.0f / std::sqrt(float(remainingTriangles));
+        return score;
+    }
+};
+#endif
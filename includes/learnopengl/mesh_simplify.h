@@ -0,0 +1,365 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// quadric-error-metric mesh simplifier (Garland & Heckbert) using half-edge collapses,
+// so the simplified index buffers reference the original vertices and can share their vertex buffer.
+// - UV seams: vertices that share a position with another vertex (attribute seams left over after welding) are never moved
+// - borders: vertices on open or non-manifold edges are never moved, so silhouettes of open meshes stay intact
+// - skinning: a vertex only collapses onto a neighbour that is dominated by the same bone, so joints keep their deformation
+class MeshSimplifier
+{
+public:
+    // coarser levels stop being generated once a mesh drops below this many triangles
+    static const unsigned int kMinLodTriangles = 64;
+
+    // simplifies a triangle list towards targetIndexCount, stopping early when the next collapse would exceed targetError
+    // (relative to the mesh extent). The achieved error is written to resultError.
+    static vector<unsigned int> simplify(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t targetIndexCount, float targetError, float *resultError = nullptr)
+    {
+        const size_t vertexCount = vertices.size();
+        vector<unsigned int> result(indices);
+        if (resultError)
+            *resultError = 0.0f;
+        if (indices.size() <= targetIndexCount || vertexCount == 0)
+            return result;
+
+        // vertices sharing a position are grouped under one canonical vertex
+        vector<unsigned int> canonical(vertexCount);
+        vector<unsigned int> groupSize(vertexCount, 0);
+        {
+            std::unordered_map<uint64_t, vector<unsigned int>> positions;
+            positions.reserve(vertexCount);
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                vector<unsigned int> &bucket = positions[positionKey(vertices[v].Position)];
+                canonical[v] = static_cast<unsigned int>(v);
+                for (size_t k = 0; k < bucket.size(); k++)
+                {
+                    if (vertices[bucket[k]].Position == vertices[v].Position)
+                    {
+                        canonical[v] = canonical[bucket[k]];
+                        break;
+                    }
+                }
+                bucket.push_back(static_cast<unsigned int>(v));
+                groupSize[canonical[v]]++;
+            }
+        }
+
+        // lock seams, borders and non-manifold edges
+        vector<bool> locked(vertexCount, false);
+        for (size_t v = 0; v < vertexCount; v++)
+            if (groupSize[canonical[v]] > 1)
+                locked[v] = true;
+        {
+            std::unordered_map<uint64_t, int> edges; // directed edge between canonical vertices -> use count
+            edges.reserve(indices.size());
+            for (size_t i = 0; i < indices.size(); i += 3)
+                for (int k = 0; k < 3; k++)
+                    edges[edgeKey(canonical[indices[i + k]], canonical[indices[i + (k + 1) % 3]])]++;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int a = canonical[indices[i + k]], b = canonical[indices[i + (k + 1) % 3]];
+                    auto opposite = edges.find(edgeKey(b, a));
+                    if (opposite == edges.end() || opposite->second != 1 || edges[edgeKey(a, b)] != 1)
+                    {
+                        locked[indices[i + k]] = true;
+                        locked[indices[i + (k + 1) % 3]] = true;
+                    }
+                }
+            }
+        }
+        // seam and border state is per position, propagate it to every vertex of the group
+        for (size_t v = 0; v < vertexCount; v++)
+            if (locked[v])
+                locked[canonical[v]] = true;
+        for (size_t v = 0; v < vertexCount; v++)
+            if (locked[canonical[v]])
+                locked[v] = true;
+
+        vector<int> dominantBone(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            dominantBone[v] = findDominantBone(vertices[v]);
+
+        // error is measured relative to the mesh extent so the same threshold works for any model scale
+        glm::vec3 minPosition(std::numeric_limits<float>::max()), maxPosition(-std::numeric_limits<float>::max());
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            minPosition = glm::min(minPosition, vertices[v].Position);
+            maxPosition = glm::max(maxPosition, vertices[v].Position);
+        }
+        glm::vec3 size = maxPosition - minPosition;
+        const double extent = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+        const double maxCost = double(targetError) * extent * double(targetError) * extent;
+
+        // plane quadrics, accumulated per position group
+        vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const glm::vec3 &p0 = vertices[indices[i]].Position;
+            const glm::vec3 &p1 = vertices[indices[i + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[i + 2]].Position;
+            Quadric q = Quadric::fromTriangle(p0, p1, p2);
+            for (int k = 0; k < 3; k++)
+                quadrics[canonical[indices[i + k]]].add(q);
+        }
+
+        vector<unsigned int> remap(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            remap[v] = static_cast<unsigned int>(v);
+
+        double achievedCost = 0.0;
+        vector<Collapse> collapses;
+        vector<unsigned int> offsets, adjacency, fill;
+        vector<bool> touched(vertexCount);
+
+        while (result.size() > targetIndexCount)
+        {
+            // vertex -> triangle adjacency of the current result
+            offsets.assign(vertexCount + 1, 0);
+            for (size_t i = 0; i < result.size(); i++)
+                offsets[result[i] + 1]++;
+            for (size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+            adjacency.resize(result.size());
+            fill.assign(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+
+            // candidate half-edge collapses, cheapest first
+            collapses.clear();
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                    if (canCollapse(a, b, locked, dominantBone))
+                        collapses.push_back({ a, b, collapseCost(quadrics, canonical, vertices, a, b) });
+                    if (canCollapse(b, a, locked, dominantBone))
+                        collapses.push_back({ b, a, collapseCost(quadrics, canonical, vertices, b, a) });
+                }
+            }
+            if (collapses.empty())
+                break;
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &l, const Collapse &r) { return l.cost < r.cost; });
+
+            // apply independent collapses: every collapse removes about two triangles
+            const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+            size_t removed = 0, applied = 0;
+            std::fill(touched.begin(), touched.end(), false);
+            for (size_t c = 0; c < collapses.size() && removed < trianglesToRemove; c++)
+            {
+                const Collapse &collapse = collapses[c];
+                if (collapse.cost > maxCost)
+                    break;
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+                if (hasTriangleFlip(vertices, result, offsets, adjacency, collapse.from, collapse.to))
+                    continue;
+
+                // the one-ring of the collapsed vertex changes shape, so keep it out of this pass
+                for (unsigned int t = offsets[collapse.from]; t < offsets[collapse.from + 1]; t++)
+                    for (int k = 0; k < 3; k++)
+                        touched[result[adjacency[t] * 3 + k]] = true;
+
+                remap[collapse.from] = collapse.to;
+                quadrics[canonical[collapse.to]].add(quadrics[canonical[collapse.from]]);
+                achievedCost = std::max(achievedCost, collapse.cost);
+                removed += 2;
+                applied++;
+            }
+            if (applied == 0)
+                break;
+
+            // rewrite the index buffer and drop triangles that collapsed to a line
+            size_t write = 0;
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+                if (a == b || b == c || c == a)
+                    continue;
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+            result.resize(write);
+        }
+
+        if (resultError)
+            *resultError = static_cast<float>(std::sqrt(achievedCost) / extent);
+        return result;
+    }
+
+    // appends successively coarser levels to the index buffer and returns the chain, LOD 0 being the full mesh.
+    // each level targets reductionRatio of the previous triangle count and is simplified from the full mesh, so errors don't compound.
+    static vector<MeshLod> buildLodChain(const vector<Vertex> &vertices, vector<unsigned int> &indices, unsigned int maxLods = 4, float reductionRatio = 0.5f, float maxError = 0.05f)
+    {
+        vector<MeshLod> lods;
+        MeshLod full;
+        full.indexCount = static_cast<unsigned int>(indices.size());
+        lods.push_back(full);
+
+        const vector<unsigned int> source(indices);
+        size_t previousCount = source.size();
+        while (lods.size() < maxLods)
+        {
+            size_t target = static_cast<size_t>(previousCount / 3 * reductionRatio) * 3;
+            if (target < kMinLodTriangles * 3)
+                break;
+
+            float error = 0.0f;
+            vector<unsigned int> lod = simplify(vertices, source, target, maxError, &error);
+            // stop when simplification stalls on locked seams/borders or the error bound
+            if (lod.empty() || lod.size() > previousCount * 9 / 10)
+                break;
+            MeshOptimizer::optimizeVertexCache(lod, vertices.size());
+
+            MeshLod level;
+            level.indexOffset = static_cast<unsigned int>(indices.size());
+            level.indexCount = static_cast<unsigned int>(lod.size());
+            level.error = error;
+            lods.push_back(level);
+            indices.insert(indices.end(), lod.begin(), lod.end());
+            previousCount = lod.size();
+        }
+        return lods;
+    }
+
+private:
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    // symmetric 4x4 quadric matrix, upper triangle
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+
+        static Quadric fromTriangle(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+        {
+            Quadric q;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(n);
+            if (area <= 0.0f)
+                return q;
+            n /= area;
+            double a = n.x, b = n.y, c = n.z, d = -glm::dot(n, p0);
+            // weight by area so large faces dominate the error
+            double w = area * 0.5;
+            q.a00 = w * a * a; q.a01 = w * a * b; q.a02 = w * a * c; q.a03 = w * a * d;
+            q.a11 = w * b * b; q.a12 = w * b * c; q.a13 = w * b * d;
+            q.a22 = w * c * c; q.a23 = w * c * d;
+            q.a33 = w * d * d;
+            return q;
+        }
+
+        void add(const Quadric &o)
+        {
+            a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+            a11 += o.a11; a12 += o.a12; a13 += o.a13;
+            a22 += o.a22; a23 += o.a23;
+            a33 += o.a33;
+        }
+
+        double evaluate(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                 + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                 + a22 * z * z + 2 * a23 * z
+                 + a33;
+        }
+
+        double weight() const { return a00 + a11 + a22; } // sum of plane weights, since each plane normal is unit length
+    };
+
+    static bool canCollapse(unsigned int from, unsigned int to, const vector<bool> &locked, const vector<int> &dominantBone)
+    {
+        return from != to && !locked[from] && dominantBone[from] == dominantBone[to];
+    }
+
+    static double collapseCost(const vector<Quadric> &quadrics, const vector<unsigned int> &canonical, const vector<Vertex> &vertices, unsigned int from, unsigned int to)
+    {
+        Quadric q = quadrics[canonical[from]];
+        q.add(quadrics[canonical[to]]);
+        double weight = q.weight();
+        // normalize by the accumulated area so the cost is a squared distance
+        return weight > 0.0 ? std::max(q.evaluate(vertices[to].Position), 0.0) / weight : 0.0;
+    }
+
+    // rejects collapses that would turn a triangle around the moved vertex upside down
+    static bool hasTriangleFlip(const vector<Vertex> &vertices, const vector<unsigned int> &result, const vector<unsigned int> &offsets,
+                                const vector<unsigned int> &adjacency, unsigned int from, unsigned int to)
+    {
+        const glm::vec3 &target = vertices[to].Position;
+        for (unsigned int t = offsets[from]; t < offsets[from + 1]; t++)
+        {
+            const unsigned int *tri = &result[adjacency[t] * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to)
+                continue; // collapses to a line and is removed
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; k++)
+            {
+                p[k] = vertices[tri[k]].Position;
+                q[k] = tri[k] == from ? target : p[k];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(before, after) <= 0.0f)
+                return true;
+        }
+        return false;
+    }
+
+    static int findDominantBone(const Vertex &vertex)
+    {
+        int bone = -1;
+        float weight = 0.0f;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            if (vertex.m_BoneIDs[i] >= 0 && vertex.m_Weights[i] > weight)
+            {
+                weight = vertex.m_Weights[i];
+                bone = vertex.m_BoneIDs[i];
+            }
+        }
+        return bone;
+    }
+
+    static uint64_t positionKey(const glm::vec3 &position)
+    {
+        uint32_t bits[3];
+        for (int i = 0; i < 3; i++)
+        {
+            float value = position[i] == 0.0f ? 0.0f : position[i];
+            std::memcpy(&bits[i], &value, sizeof(float));
+        }
+        return (uint64_t(bits[0]) * 73856093ull) ^ (uint64_t(bits[1]) * 19349663ull << 16) ^ (uint64_t(bits[2]) * 83492791ull << 32);
+    }
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return (uint64_t(a) << 32) | b;
+    }
+};
+#endif
@@ -0,0 +1,365 @@
+#ifndef MIP_BUILDER_H
+#define MIP_BUILDER_H
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_BUILDER_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIP_BUILDER_NEON
+#endif
+
+enum MipKernel {
+    MIP_KERNEL_BOX,     // 2x2 average, what glGenerateMipmap does on most drivers
+    MIP_KERNEL_KAISER,  // Kaiser windowed sinc, little ringing; the default
+    MIP_KERNEL_LANCZOS3 // Lanczos-3, sharpest, may ring on hard edges
+};
+
+// builds mip chains on the CPU with a windowed sinc filter. With srgb, color channels are decoded to linear light before
+// filtering and re-encoded after, so dark and bright texels are averaged as light does (alpha always stays linear).
+// each level is filtered from the previous one, separably: a vertical pass over whole rows (SSE/AVX/NEON, 4 or 8 floats
+// at a time) and a horizontal pass (one SIMD vector per RGBA texel). A level's rows are split into bands across the worker
+// pool; levels depend on each other so they run in order, different images run concurrently from the loader's workers.
+class MipBuilder
+{
+public:
+    // levels >= firstLevel of the chain down to 1x1, tightly packed 8-bit pixels like the input
+    static vector<vector<unsigned char>> build(const unsigned char *pixels, int width, int height, int components, bool srgb,
+                                               int firstLevel = 0, MipKernel kernel = MIP_KERNEL_KAISER)
+    {
+        return buildChain<true>(pixels, width, height, components, srgb, firstLevel, kernel, true);
+    }
+
+    // the same filter without SIMD or threads, the reference build() is measured and checked against
+    static vector<vector<unsigned char>> buildScalar(const unsigned char *pixels, int width, int height, int components, bool srgb,
+                                                     int firstLevel = 0, MipKernel kernel = MIP_KERNEL_KAISER)
+    {
+        return buildChain<false>(pixels, width, height, components, srgb, firstLevel, kernel, false);
+    }
+
+    // times full chains of a size x size RGBA test image with both paths and prints megapixels of input per second
+    static void benchmark(int size = 2048, MipKernel kernel = MIP_KERNEL_KAISER, std::ostream &out = std::cout)
+    {
+        vector<unsigned char> image(static_cast<size_t>(size) * size * 4);
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+                for (int c = 0; c < 4; c++)
+                    image[(static_cast<size_t>(y) * size + x) * 4 + c] = static_cast<unsigned char>((x * (c + 1) + y * (3 - c) + ((x ^ y) & 15)) & 255);
+
+        const double megapixels = double(size) * size / 1e6;
+        auto time = [&](bool simd, vector<vector<unsigned char>> &levels) {
+            const auto start = std::chrono::steady_clock::now();
+            levels = simd ? build(image.data(), size, size, 4, true, 0, kernel) : buildScalar(image.data(), size, size, 4, true, 0, kernel);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        vector<vector<unsigned char>> reference, fast;
+        const double scalarSeconds = time(false, reference);
+        const double simdSeconds = time(true, fast);
+
+        int maxDifference = 0;
+        for (size_t level = 0; level < reference.size(); level++)
+            for (size_t i = 0; i < reference[level].size(); i++)
+                maxDifference = std::max(maxDifference, std::abs(int(reference[level][i]) - int(fast[level][i])));
+        out << "MIP_BUILDER:: " << size << "x" << size << " RGBA sRGB, " << simdPath() << " x " << ThreadPool::shared().size() << " threads: "
+            << megapixels / simdSeconds << " MPix/s, scalar: " << megapixels / scalarSeconds << " MPix/s ("
+            << scalarSeconds / simdSeconds << "x), max difference " << maxDifference << std::endl;
+    }
+
+    static const char* simdPath()
+    {
+#if defined(__AVX__)
+        return "AVX";
+#elif defined(MIP_BUILDER_SSE2)
+        return "SSE2";
+#elif defined(MIP_BUILDER_NEON)
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+
+private:
+    static const int kBandRows = 16; // output rows per job
+
+    // per output coordinate of one axis: the first input coordinate and kernel weights of a fixed number of taps
+    struct Taps {
+        int count = 0;
+        vector<int> first;
+        vector<int> index;     // count per output coordinate, clamped to the edge
+        vector<float> weights; // count per output coordinate
+    };
+
+    static const int kEncodeEntries = 1 << 14;
+    struct Tables {
+        float toLinear[256];
+        float toUnit[256];
+        unsigned char toSrgb[kEncodeEntries];
+    };
+
+    static const Tables& tables()
+    {
+        static const Tables table = [] {
+            Tables t;
+            for (int i = 0; i < 256; i++)
+            {
+                const float v = i / 255.0f;
+                t.toLinear[i] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+                t.toUnit[i] = v;
+            }
+            for (int i = 0; i < kEncodeEntries; i++)
+            {
+                const float v = (i + 0.5f) / kEncodeEntries;
+                const float s = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+                t.toSrgb[i] = static_cast<unsigned char>(std::min(255.0f, s * 255.0f + 0.5f));
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    static float kernelWeight(MipKernel kernel, float x)
+    {
+        x = std::abs(x);
+        switch (kernel)
+        {
+            case MIP_KERNEL_BOX:
+                return x < 0.5f ? 1.0f : 0.0f;
+            case MIP_KERNEL_LANCZOS3:
+                return x < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+            case MIP_KERNEL_KAISER:
+            default:
+            {
+                // sinc windowed by Kaiser(alpha = 4) over a radius of 3, as in NVIDIA's texture tools
+                const float radius = 3.0f, alpha = 4.0f;
+                if (x >= radius)
+                    return 0.0f;
+                const float r = x / radius;
+                return sinc(x) * besselI0(alpha * std::sqrt(1.0f - r * r)) / besselI0(alpha);
+            }
+        }
+    }
+
+    static float kernelRadius(MipKernel kernel)
+    {
+        return kernel == MIP_KERNEL_BOX ? 0.5f : 3.0f;
+    }
+
+    static float sinc(float x)
+    {
+        if (x < 1e-5f)
+            return 1.0f;
+        const float px = 3.14159265358979f * x;
+        return std::sin(px) / px;
+    }
+
+    static float besselI0(float x)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 20; k++)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // taps for shrinking inSize samples to outSize, the kernel stretched by the scale factor
+    static Taps buildTaps(int inSize, int outSize, MipKernel kernel)
+    {
+        Taps taps;
+        const float scale = float(inSize) / outSize;
+        const float radius = kernelRadius(kernel) * scale;
+        taps.count = static_cast<int>(std::ceil(radius * 2.0f)) + 1;
+        taps.first.resize(outSize);
+        taps.index.resize(static_cast<size_t>(outSize) * taps.count);
+        taps.weights.assign(static_cast<size_t>(outSize) * taps.count, 0.0f);
+        for (int o = 0; o < outSize; o++)
+        {
+            const float center = (o + 0.5f) * scale - 0.5f;
+            const int first = static_cast<int>(std::floor(center - radius)) + 1;
+            taps.first[o] = first;
+            float sum = 0.0f;
+            for (int t = 0; t < taps.count; t++)
+            {
+                const float w = kernelWeight(kernel, (first + t - center) / scale);
+                taps.weights[static_cast<size_t>(o) * taps.count + t] = w;
+                taps.index[static_cast<size_t>(o) * taps.count + t] = std::min(std::max(first + t, 0), inSize - 1);
+                sum += w;
+            }
+            for (int t = 0; t < taps.count; t++)
+                taps.weights[static_cast<size_t>(o) * taps.count + t] /= sum;
+        }
+        return taps;
+    }
+
+    template <bool Simd>
+    static vector<vector<unsigned char>> buildChain(const unsigned char *pixels, int width, int height, int components, bool srgb,
+                                                    int firstLevel, MipKernel kernel, bool threaded)
+    {
+        vector<vector<unsigned char>> levels;
+        vector<unsigned char> current(pixels, pixels + static_cast<size_t>(width) * height * components);
+        int w = width, h = height;
+        for (int level = 0; ; level++)
+        {
+            if (level >= firstLevel)
+                levels.push_back(current);
+            if (w == 1 && h == 1)
+                break;
+            const int nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+            vector<unsigned char> next(static_cast<size_t>(nw) * nh * components);
+            downsample<Simd>(current.data(), w, h, next.data(), nw, nh, components, srgb, kernel, threaded);
+            current.swap(next);
+            w = nw;
+            h = nh;
+        }
+        return levels;
+    }
+
+    template <bool Simd>
+    static void downsample(const unsigned char *in, int w, int h, unsigned char *out, int nw, int nh, int c, bool srgb, MipKernel kernel, bool threaded)
+    {
+        const Taps horizontal = buildTaps(w, nw, kernel), vertical = buildTaps(h, nh, kernel);
+        // which channels carry sRGB encoded color: all but alpha
+        const int colorChannels = srgb ? (c == 2 || c == 4 ? c - 1 : c) : 0;
+        const size_t bands = (nh + kBandRows - 1) / kBandRows;
+        auto band = [&](size_t b) {
+            const int y0 = static_cast<int>(b) * kBandRows, y1 = std::min(nh, y0 + kBandRows);
+            // linearize the input rows this band reads
+            const int rowFirst = std::max(0, vertical.first[y0]);
+            const int rowLast = std::min(h - 1, vertical.first[y1 - 1] + vertical.count - 1);
+            const size_t rowFloats = static_cast<size_t>(w) * c;
+            vector<float> rows((rowLast - rowFirst + 1) * rowFloats);
+            const float *decode[4];
+            for (int k = 0; k < c; k++)
+                decode[k] = k < colorChannels ? tables().toLinear : tables().toUnit;
+            for (int y = rowFirst; y <= rowLast; y++)
+            {
+                const unsigned char *src = in + static_cast<size_t>(y) * rowFloats;
+                float *dst = &rows[(y - rowFirst) * rowFloats];
+                for (size_t i = 0; i < rowFloats; i += c)
+                    for (int k = 0; k < c; k++)
+                        dst[i + k] = decode[k][src[i + k]];
+            }
+
+            vector<float> column(rowFloats), filtered(static_cast<size_t>(nw) * c);
+            for (int y = y0; y < y1; y++)
+            {
+                // vertical pass: weighted sum of whole input rows
+                std::fill(column.begin(), column.end(), 0.0f);
+                for (int t = 0; t < vertical.count; t++)
+                {
+                    const float weight = vertical.weights[static_cast<size_t>(y) * vertical.count + t];
+                    if (weight == 0.0f)
+                        continue;
+                    const int sy = vertical.index[static_cast<size_t>(y) * vertical.count + t];
+                    accumulateRow<Simd>(column.data(), &rows[(sy - rowFirst) * rowFloats], weight, rowFloats);
+                }
+                // horizontal pass
+                filterRow<Simd>(column.data(), filtered.data(), nw, c, horizontal);
+                storeRow(filtered.data(), out + static_cast<size_t>(y) * nw * c, static_cast<size_t>(nw) * c, c, colorChannels);
+            }
+        };
+        if (threaded)
+            ThreadPool::shared().parallelFor(bands, band);
+        else
+            for (size_t b = 0; b < bands; b++)
+                band(b);
+    }
+
+    template <bool Simd>
+    static void accumulateRow(float *sum, const float *row, float weight, size_t count)
+    {
+        size_t i = 0;
+        if (Simd)
+        {
+#if defined(__AVX__)
+            const __m256 w8 = _mm256_set1_ps(weight);
+            for (; i + 8 <= count; i += 8)
+                _mm256_storeu_ps(sum + i, _mm256_add_ps(_mm256_loadu_ps(sum + i), _mm256_mul_ps(w8, _mm256_loadu_ps(row + i))));
+#endif
+#if defined(MIP_BUILDER_SSE2)
+            const __m128 w4 = _mm_set1_ps(weight);
+            for (; i + 4 <= count; i += 4)
+                _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(w4, _mm_loadu_ps(row + i))));
+#elif defined(MIP_BUILDER_NEON)
+            const float32x4_t w4 = vdupq_n_f32(weight);
+            for (; i + 4 <= count; i += 4)
+                vst1q_f32(sum + i, vmlaq_f32(vld1q_f32(sum + i), w4, vld1q_f32(row + i)));
+#endif
+        }
+        for (; i < count; i++)
+            sum[i] += weight * row[i];
+    }
+
+    template <bool Simd>
+    static void filterRow(const float *in, float *out, int nw, int c, const Taps &taps)
+    {
+#if defined(MIP_BUILDER_SSE2) || defined(MIP_BUILDER_NEON)
+        if (Simd && c == 4)
+        {
+            for (int x = 0; x < nw; x++)
+            {
+                const float *weights = &taps.weights[static_cast<size_t>(x) * taps.count];
+                const int *index = &taps.index[static_cast<size_t>(x) * taps.count];
+#if defined(MIP_BUILDER_SSE2)
+                __m128 sum = _mm_setzero_ps();
+                for (int t = 0; t < taps.count; t++)
+                {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(in + index[t] * 4)));
+                }
+                _mm_storeu_ps(out + x * 4, sum);
+#else
+                float32x4_t sum = vdupq_n_f32(0.0f);
+                for (int t = 0; t < taps.count; t++)
+                {
+                    sum = vmlaq_f32(sum, vdupq_n_f32(weights[t]), vld1q_f32(in + index[t] * 4));
+                }
+                vst1q_f32(out + x * 4, sum);
+#endif
+            }
+            return;
+        }
+#endif
+        for (int x = 0; x < nw; x++)
+        {
+            const float *weights = &taps.weights[static_cast<size_t>(x) * taps.count];
+            const int *index = &taps.index[static_cast<size_t>(x) * taps.count];
+            for (int k = 0; k < c; k++)
+            {
+                float sum = 0.0f;
+                for (int t = 0; t < taps.count; t++)
+                    sum += weights[t] * in[index[t] * c + k];
+                out[x * c + k] = sum;
+            }
+        }
+    }
+
+    // back to 8 bits, clamping the kernel's overshoot
+    static void storeRow(const float *in, unsigned char *out, size_t count, int c, int colorChannels)
+    {
+        const unsigned char *toSrgb = tables().toSrgb;
+        for (size_t i = 0; i < count; i += c)
+            for (int k = 0; k < c; k++)
+            {
+                const float v = std::min(1.0f, std::max(0.0f, in[i + k]));
+                if (k < colorChannels)
+                    out[i + k] = toSrgb[std::min(kEncodeEntries - 1, static_cast<int>(v * kEncodeEntries))];
+                else
+                    out[i + k] = static_cast<unsigned char>(v * 255.0f + 0.5f);
+            }
+    }
+};
+#endif
@@ -11,13 +11,20 @@
 #include <assimp/postprocess.h>
 
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplify.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/texture_streamer.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <learnopengl/assimp_glm_helpers.h>
 #include <learnopengl/animdata.h>
@@ -28,24 +35,77 @@ class Model
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once. Each holds a TextureRegistry reference
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    WeldSettings weldSettings;
+    unsigned int cpuDataUsage; // MeshCpuDataUsage flags: which CPU copies meshes keep after upload
+    UploadQueue *uploads; // must outlive the model, which drops its textures' pending uploads when it releases them
+    TextureStreamer *streamer; // must outlive the model
+    MeshOptimizationReport optimizationReport; // weld and vertex cache/overdraw optimization results over all meshes
+    vector<float> lodErrors; // per level of detail, the largest simplification error over all meshes
 	
 	
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // with an upload queue, textures and buffers are streamed in by its per-frame process() instead of uploaded here.
+    // with a texture streamer, textures start at low resolution and get finer mips as they are requested on screen
+    Model(string const &path, bool gamma = false, const WeldSettings &weld = WeldSettings(), unsigned int cpuDataUsage = MESH_CPU_DATA_NONE, UploadQueue *uploads = nullptr, TextureStreamer *streamer = nullptr)
+        : gammaCorrection(gamma), weldSettings(weld), cpuDataUsage(cpuDataUsage), uploads(uploads), streamer(streamer)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // the GL textures are shared through the TextureRegistry; moving hands our references over, copying would double them
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&&) = default; // leaves other.textures_loaded empty, so only this Model releases them
+    Model& operator=(Model&&) = delete;
+
+    ~Model()
     {
+        for(unsigned int i = 0; i < textures_loaded.size(); i++)
+        {
+            if(!TextureRegistry::release(textures_loaded[i].id))
+                continue;
+            // the name is gone, so nothing may still be uploaded to it
+            if(streamer)
+                streamer->remove(textures_loaded[i].id);
+            if(uploads)
+                uploads->cancelTexture(textures_loaded[i].id);
+        }
+    }
+
+    // draws the model, and thus all its meshes, at the given level of detail. Returns the number of triangles submitted
+    unsigned int Draw(Shader &shader, unsigned int lod = 0, ClusterCulling *culling = nullptr)
+    {
+        unsigned int triangles = 0;
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            triangles += meshes[i].Draw(shader, lod, culling);
+        return triangles;
+    }
+
+    // offline cook step: block compresses every texture of the model into a .ktx2 next to its source, which later
+    // loads upload directly instead of decoding the source. Normal maps become BC5 (X and Y only)
+    vector<TextureCompressionReport> CookTextures() const
+    {
+        vector<TextureCompressionReport> reports;
+        for(unsigned int i = 0; i < textures_loaded.size(); i++)
+        {
+            const TextureUsage usage = textures_loaded[i].type == "texture_normal" ? TEXTURE_USAGE_NORMAL : TEXTURE_USAGE_COLOR;
+            reports.push_back(TextureLoader::cook(textures_loaded[i].path, directory, usage, isSrgbTexture(textures_loaded[i].type)));
+        }
+        return reports;
+    }
+
+    // number of triangles drawn at a level of detail, used to report how much the LOD selection saves
+    unsigned int GetTriangleCount(unsigned int lod = 0) const
+    {
+        unsigned int triangles = 0;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            triangles += meshes[i].lods[std::min<size_t>(lod, meshes[i].lods.size() - 1)].indexCount / 3;
+        return triangles;
     }
     
 	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
@@ -53,6 +113,7 @@ public:
 	
 
 private:
+    unordered_map<string, unsigned int> textureIndex; // path -> index into textures_loaded
 
 	std::map<string, BoneInfo> m_BoneInfoMap;
 	int m_BoneCounter = 0;
@@ -72,8 +133,23 @@ private:
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
+        // decode every material texture up front and in parallel, so processing the meshes only looks them up
+        preloadMaterialTextures(scene);
+
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+
+        // a model level is as coarse as its coarsest mesh at that level; meshes with shorter chains stay at their last level
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if(meshes[i].lods.size() > lodErrors.size())
+                lodErrors.resize(meshes[i].lods.size(), 0.0f);
+        }
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            for(unsigned int lod = 0; lod < lodErrors.size(); lod++)
+                lodErrors[lod] = std::max(lodErrors[lod], meshes[i].lods[std::min<size_t>(lod, meshes[i].lods.size() - 1)].error);
+        }
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -85,7 +161,7 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshes.emplace_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
@@ -113,7 +189,7 @@ private:
 
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
-			Vertex vertex;
+			Vertex vertex{}; // zero-initialized so attributes the mesh lacks compare equal when welding
 			SetVertexBoneDataToDefault(vertex);
 			vertex.Position = AssimpGLMHelpers::GetGLMVec(mesh->mVertices[i]);
 			vertex.Normal = AssimpGLMHelpers::GetGLMVec(mesh->mNormals[i]);
@@ -148,8 +224,17 @@ private:
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 		ExtractBoneWeightForVertices(vertices,mesh,scene);
-
-		return Mesh(vertices, indices, textures);
+		// weld and reorder once bone weights are attached, so welding can tell skinned vertices apart
+		optimizationReport.accumulate(MeshOptimizer::optimize(vertices, indices, weldSettings));
+		vector<MeshLod> lods = MeshSimplifier::buildLodChain(vertices, indices);
+		// cluster bounds and normal cones come from the bind pose and don't hold once bones move the vertices, so skinned
+		// meshes get no clusters and always draw whole
+		vector<MeshCluster> clusters;
+		if (mesh->mNumBones == 0)
+			clusters = MeshClusterizer::build(vertices, indices, lods[0].indexOffset, lods[0].indexCount);
+
+		// skinning runs on the GPU (finalBonesMatrices), so the CPU copies are only kept when cpuDataUsage asks for them
+		return Mesh(std::move(vertices), std::move(indices), std::move(textures), std::move(lods), std::move(clusters), cpuDataUsage, uploads);
 	}
 
 	void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
@@ -205,43 +290,115 @@ private:
 
 	unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false)
 	{
-		string filename = string(path);
-		filename = directory + '/' + filename;
+		DecodedImage image = TextureLoader::decode(path, directory);
+		TextureLoader::generateMips(image, gamma);
+		return TextureLoader::upload(image);
+	}
+
+    // collects the texture paths of all materials, then decodes them concurrently on the worker pool and uploads them
+    // on this (the context) thread as they finish. Fills textures_loaded, which loadMaterialTextures then hits every time.
+    void preloadMaterialTextures(const aiScene *scene)
+    {
+        const aiTextureType types[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT };
+        const char *typeNames[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+        set<string> seen;
+        set<string> queuedKeys;
+        // paths spelled differently that name a file already queued ("a.png" and "./a.png"), shared once it is loaded
+        vector<pair<string, string>> aliases; // path, type
+        vector<string> aliasKeys;
+        for(unsigned int i = 0; i < textures_loaded.size(); i++)
+            seen.insert(textures_loaded[i].path);
+        vector<string> paths;
+        vector<string> pathTypes;
+        vector<string> keys;
+        for(unsigned int m = 0; m < scene->mNumMaterials; m++)
+        {
+            aiMaterial *material = scene->mMaterials[m];
+            for(unsigned int t = 0; t < 4; t++)
+            {
+                for(unsigned int i = 0; i < material->GetTextureCount(types[t]); i++)
+                {
+                    aiString str;
+                    material->GetTexture(types[t], i, &str);
+                    if(!seen.insert(str.C_Str()).second)
+                        continue;
+                    // textures another Model already loaded are shared instead of decoded again
+                    string key = TextureRegistry::normalizePath(this->directory + '/' + str.C_Str());
+                    unsigned int id;
+                    if(TextureRegistry::acquire(key, id))
+                        addLoadedTexture(id, typeNames[t], str.C_Str());
+                    else if(!queuedKeys.insert(key).second)
+                    {
+                        aliases.push_back({ str.C_Str(), typeNames[t] });
+                        aliasKeys.push_back(key);
+                    }
+                    else
+                    {
+                        paths.push_back(str.C_Str());
+                        pathTypes.push_back(typeNames[t]);
+                        keys.push_back(key);
+                    }
+                }
+            }
+        }
 
-		unsigned int textureID;
-		glGenTextures(1, &textureID);
+        vector<bool> srgb;
+        for(unsigned int i = 0; i < pathTypes.size(); i++)
+            srgb.push_back(isSrgbTexture(pathTypes[i]));
+        vector<size_t> bytes;
+        vector<unsigned int> ids;
+        if(streamer)
+        {
+            const string &dir = this->directory;
+            TextureLoader::decodeAll(paths, dir, [&dir, &srgb](size_t i, DecodedImage image) { return TextureStreamer::prepare(std::move(image), dir, srgb[i]); },
+                [this, &ids, &bytes](size_t, StreamingImage image) {
+                    ids.push_back(streamer->create(std::move(image)));
+                    bytes.push_back(streamer->residentSize(ids.back()));
+                }, false);
+        }
+        else
+            ids = TextureLoader::loadAll(paths, this->directory, gammaCorrection, &bytes, uploads, &srgb);
+        for(unsigned int i = 0; i < paths.size(); i++)
+        {
+            const unsigned int id = TextureRegistry::insert(keys[i], ids[i], bytes[i]);
+            if(id != ids[i])
+                dropDuplicate(ids[i]);
+            addLoadedTexture(id, pathTypes[i], paths[i]);
+        }
+        for(unsigned int i = 0; i < aliases.size(); i++)
+        {
+            unsigned int id;
+            if(TextureRegistry::acquire(aliasKeys[i], id))
+                addLoadedTexture(id, aliases[i].second, aliases[i].first);
+        }
+    }
 
-		int width, height, nrComponents;
-		unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-		if (data)
-		{
-			GLenum format;
-			if (nrComponents == 1)
-				format = GL_RED;
-			else if (nrComponents == 3)
-				format = GL_RGB;
-			else if (nrComponents == 4)
-				format = GL_RGBA;
-
-			glBindTexture(GL_TEXTURE_2D, textureID);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Texture failed to load at path: " << path << std::endl;
-			stbi_image_free(data);
-		}
+    // a texture created for a key that turned out to be registered already was deleted by the registry; forget it
+    // wherever it was handed to
+    void dropDuplicate(unsigned int id)
+    {
+        if(streamer)
+            streamer->remove(id);
+        if(uploads)
+            uploads->cancelTexture(id);
+    }
 
-		return textureID;
-	}
+    void addLoadedTexture(unsigned int id, const string &type, const string &path)
+    {
+        Texture texture;
+        texture.id = id;
+        texture.type = type;
+        texture.path = path;
+        textureIndex[path] = static_cast<unsigned int>(textures_loaded.size());
+        textures_loaded.push_back(texture);
+    }
+
+    // diffuse maps hold gamma encoded color; when rendering gamma correct their mips are filtered in linear light
+    bool isSrgbTexture(const string &type) const
+    {
+        return gammaCorrection && type == "texture_diffuse";
+    }
     
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
@@ -253,24 +410,37 @@ private:
             aiString str;
             mat->GetTexture(type, i, &str);
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            auto loaded = textureIndex.find(str.C_Str());
+            if(loaded != textureIndex.end())
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                textures.push_back(textures_loaded[loaded->second]);
+                textures.back().type = typeName; // the same file may be bound under a different sampler type by another material
+            }
+            else
+            {   // if texture hasn't been loaded already, load it (or share it if another Model has)
+                string key = TextureRegistry::normalizePath(this->directory + '/' + str.C_Str());
+                unsigned int id;
+                if(!TextureRegistry::acquire(key, id))
                 {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
+                    DecodedImage image = TextureLoader::decode(str.C_Str(), this->directory, streamer == nullptr);
+                    size_t bytes = TextureLoader::textureBytes(image);
+                    if(streamer)
+                    {
+                        id = streamer->create(TextureStreamer::prepare(std::move(image), this->directory, isSrgbTexture(typeName)));
+                        bytes = streamer->residentSize(id);
+                    }
+                    else
+                    {
+                        TextureLoader::generateMips(image, isSrgbTexture(typeName));
+                        id = uploads ? TextureLoader::uploadAsync(std::move(image), *uploads) : TextureLoader::upload(image);
+                    }
+                    const unsigned int registered = TextureRegistry::insert(key, id, bytes);
+                    if(registered != id)
+                        dropDuplicate(id);
+                    id = registered;
                 }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+                addLoadedTexture(id, typeName, str.C_Str());  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+                textures.push_back(textures_loaded.back());
             }
         }
         return textures;
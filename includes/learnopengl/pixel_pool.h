@@ -0,0 +1,110 @@
+#ifndef PIXEL_POOL_H
+#define PIXEL_POOL_H
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+struct PixelPoolStatistics {
+    unsigned long long reused = 0;    // acquire() calls served from a returned buffer
+    unsigned long long allocated = 0; // acquire() calls that had to allocate
+    size_t retainedBytes = 0;         // held for reuse right now
+};
+
+// recycles the pixel buffers images are decoded into (see TextureLoader::decode), so loading many textures doesn't
+// allocate and free a whole image for every one of them. A returned buffer is handed out again for a request of at least
+// half its size; at most maxRetainedBytes are kept, the rest is freed on release. Thread safe
+class PixelPool
+{
+public:
+    explicit PixelPool(size_t maxRetainedBytes = 128 * 1024 * 1024)
+        : maxRetainedBytes(maxRetainedBytes)
+    {
+    }
+
+    ~PixelPool()
+    {
+        trim();
+    }
+
+    PixelPool(const PixelPool&) = delete;
+    PixelPool& operator=(const PixelPool&) = delete;
+
+    // process-wide pool the texture loader decodes into
+    static PixelPool& shared()
+    {
+        static PixelPool pool;
+        return pool;
+    }
+
+    // a buffer of at least bytes, whose actual size is returned in capacity for release(). Contents are undefined
+    unsigned char* acquire(size_t bytes, size_t &capacity)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // smallest free buffer that fits without wasting more than half of it
+            size_t best = available.size();
+            for (size_t i = 0; i < available.size(); i++)
+                if (available[i].capacity >= bytes && available[i].capacity / 2 <= bytes && (best == available.size() || available[i].capacity < available[best].capacity))
+                    best = i;
+            if (best != available.size())
+            {
+                Block block = available[best];
+                available[best] = available.back();
+                available.pop_back();
+                statistics.retainedBytes -= block.capacity;
+                statistics.reused++;
+                capacity = block.capacity;
+                return block.bytes;
+            }
+            statistics.allocated++;
+        }
+        capacity = std::max<size_t>(bytes, 1);
+        return new unsigned char[capacity];
+    }
+
+    void release(unsigned char *bytes, size_t capacity)
+    {
+        if (!bytes)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (statistics.retainedBytes + capacity <= maxRetainedBytes)
+            {
+                available.push_back(Block{bytes, capacity});
+                statistics.retainedBytes += capacity;
+                return;
+            }
+        }
+        delete[] bytes;
+    }
+
+    // frees every buffer held for reuse, e.g. once a level has finished loading
+    void trim()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Block &block : available)
+            delete[] block.bytes;
+        available.clear();
+        statistics.retainedBytes = 0;
+    }
+
+    PixelPoolStatistics getStatistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return statistics;
+    }
+
+private:
+    struct Block {
+        unsigned char *bytes;
+        size_t capacity;
+    };
+
+    size_t maxRetainedBytes;
+    vector<Block> available;
+    std::mutex mutex;
+    PixelPoolStatistics statistics;
+};
+#endif
@@ -0,0 +1,246 @@
+#ifndef PROGRAM_BATCH_H
+#define PROGRAM_BATCH_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_source.h>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// the programs of a ProgramBatch still compiling, and since when the first of them was submitted. When the last one
+// is finished, the interval goes to ProgramCache::statistics() as one batch
+struct ProgramBatchTiming {
+    std::chrono::steady_clock::time_point start;
+    unsigned int outstanding = 0;
+
+    void begin()
+    {
+        if (outstanding++ == 0)
+            start = std::chrono::steady_clock::now();
+    }
+
+    void end()
+    {
+        if (--outstanding == 0)
+            ProgramCache::statistics().batchMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// a program submitted to a ProgramBatch, which behaves like a future: ready() polls without waiting, get() waits for
+// the driver, checks the result (printing compile and link errors like the Shader classes do) and gives the linked
+// program, or 0 when it failed. Hand that to a Shader, e.g. Shader shader(handle.get()), when the program is first
+// needed. Copies share the program; one that nobody took with get() is deleted with the last copy
+class ProgramHandle
+{
+public:
+    ProgramHandle() = default;
+
+    bool valid() const
+    {
+        return state != nullptr;
+    }
+
+    // true once get() won't wait for the driver. Without KHR_parallel_shader_compile that can't be asked without
+    // waiting, so it is always true and get() may block
+    bool ready() const
+    {
+        if (!state || state->finished || !parallelCompile())
+            return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(state->program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    GLuint get()
+    {
+        if (!state)
+            return 0;
+        state->finish();
+        state->taken = true;
+        return state->program;
+    }
+
+    // whether the context compiles in the background, checked once per process
+    static bool parallelCompile()
+    {
+        static const bool supported = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+        return supported;
+    }
+
+private:
+    friend class ProgramBatch;
+
+    struct Stage {
+        GLuint shader;
+        const char *type; // for error messages, as in checkCompileErrors
+    };
+
+    struct State {
+        GLuint program = 0;
+        std::vector<Stage> stages;
+        ProgramCache::Lookup cache;
+        std::shared_ptr<ProgramBatchTiming> timing; // set while the cache is on
+        bool finished = false;
+        bool taken = false;
+
+        explicit State(ProgramCache::Lookup lookup)
+            : cache(std::move(lookup))
+        {
+        }
+
+        ~State()
+        {
+            finish();
+            if (!taken && program)
+                glDeleteProgram(program);
+        }
+
+        // the first status query, so the first point the driver has to be done with the program
+        void finish()
+        {
+            if (finished)
+                return;
+            finished = true;
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked)
+            {
+                // a failed link is usually a failed compile, which the stages report better
+                GLchar infoLog[1024];
+                GLint compiled = GL_FALSE;
+                for (const Stage &stage : stages)
+                {
+                    glGetShaderiv(stage.shader, GL_COMPILE_STATUS, &compiled);
+                    if (!compiled)
+                    {
+                        glGetShaderInfoLog(stage.shader, 1024, NULL, infoLog);
+                        std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << stage.type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                    }
+                }
+                glGetProgramInfoLog(program, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+            if (!stages.empty())
+                cache.store(program);
+            if (timing)
+                timing->end();
+            for (const Stage &stage : stages)
+                glDeleteShader(stage.shader);
+            stages.clear();
+            if (!linked)
+            {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+    };
+
+    std::shared_ptr<State> state;
+
+    static bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLubyte *extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+            if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+                return true;
+        }
+        return false;
+    }
+};
+
+// builds many programs without stalling on each one. add() reads the sources and hands every stage and the link to the
+// driver right away, but never asks for a compile or link status, which is what makes a driver finish the work (and
+// the Shader constructors ask straight after each step). With KHR_parallel_shader_compile the driver compiles on its
+// own threads meanwhile, so submitting all programs up front and taking them with ProgramHandle::get() only when
+// first used overlaps compilation with loading models and textures; elsewhere the compile still moves to the first
+// get(), after everything was submitted. Programs go through the ProgramCache like the Shader classes do; their
+// compiles are timed together, from the first submit to the last get()
+class ProgramBatch
+{
+public:
+    ProgramHandle add(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr)
+    {
+        std::vector<std::pair<GLenum, std::string>> stages;
+        stages.emplace_back(GL_VERTEX_SHADER, ShaderSource::load(vertexPath));
+        stages.emplace_back(GL_FRAGMENT_SHADER, ShaderSource::load(fragmentPath));
+        if (geometryPath != nullptr)
+            stages.emplace_back(GL_GEOMETRY_SHADER, ShaderSource::load(geometryPath));
+        return submit(stages);
+    }
+
+    ProgramHandle addCompute(const char *computePath)
+    {
+        std::vector<std::pair<GLenum, std::string>> stages;
+        stages.emplace_back(GL_COMPUTE_SHADER, ShaderSource::load(computePath));
+        return submit(stages);
+    }
+
+    // a program from sources already in memory, as (stage, source) pairs
+    ProgramHandle submit(const std::vector<std::pair<GLenum, std::string>> &sources)
+    {
+        std::vector<std::pair<GLenum, const std::string*>> stages;
+        for (const auto &source : sources)
+            stages.emplace_back(source.first, &source.second);
+        ProgramHandle handle;
+        handle.state = std::make_shared<ProgramHandle::State>(ProgramCache::Lookup(stages));
+        ProgramHandle::State &state = *handle.state;
+        state.program = state.cache.load();
+        if (state.program != 0)
+        {
+            state.finished = true;
+            return handle;
+        }
+
+        state.cache.batch();
+        if (ProgramCache::enabled())
+        {
+            state.timing = timing;
+            timing->begin();
+        }
+        state.program = glCreateProgram();
+        for (const auto &source : sources)
+        {
+            const char *code = source.second.c_str();
+            GLuint shader = glCreateShader(source.first);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            glAttachShader(state.program, shader);
+            state.stages.push_back(ProgramHandle::Stage{shader, stageName(source.first)});
+        }
+        state.cache.prepare(state.program);
+        glLinkProgram(state.program);
+        return handle;
+    }
+
+private:
+    std::shared_ptr<ProgramBatchTiming> timing = std::make_shared<ProgramBatchTiming>();
+
+    static const char* stageName(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_VERTEX_SHADER: return "VERTEX";
+            case GL_FRAGMENT_SHADER: return "FRAGMENT";
+            case GL_GEOMETRY_SHADER: return "GEOMETRY";
+            case GL_TESS_CONTROL_SHADER: return "TESS_CONTROL";
+            case GL_TESS_EVALUATION_SHADER: return "TESS_EVALUATION";
+            case GL_COMPUTE_SHADER: return "COMPUTE";
+        }
+        return "UNKNOWN";
+    }
+};
+#endif
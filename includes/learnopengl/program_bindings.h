@@ -0,0 +1,188 @@
+#ifndef PROGRAM_BINDINGS_H
+#define PROGRAM_BINDINGS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/uniform_table.h>
+
+// a uniform of a reflected program (see src/tools/shader_reflect.cpp) holding a T: the index of its location in
+// ProgramBindings. Setting it with a value of another type doesn't compile
+template <class T>
+struct UniformSlot {
+    unsigned int index;
+};
+
+// a uniform array of T, set as a whole
+template <class T>
+struct UniformArraySlot {
+    unsigned int index;
+    GLsizei count;
+};
+
+// a sampler, with the texture unit shader_reflect gave it (array elements take the units after it)
+struct SamplerSlot {
+    unsigned int index;
+    GLint unit;
+};
+
+// the locations of every uniform the generated Program struct declares, found once when a shader is built, so that
+// setting a uniform is an array access: bindings.set(ShaderProgram::transform, matrix). Samplers are pointed at their
+// fixed units right away, so drawing only needs bindTexture(). Uniforms the driver optimized out have location -1 and
+// are ignored like glUniform* ignores them. set() works on the program in use and goes through the shader's shadow
+// values like the Shader setters do, so the two mix freely and unchanged values are skipped and counted alike; arrays
+// are uploaded whole every time
+template <class Program>
+class ProgramBindings
+{
+public:
+    ProgramBindings()
+    {
+        for (unsigned int i = 0; i <= Program::kUniformCount; i++)
+        {
+            locations[i] = -1;
+            slots[i] = -1;
+            firstElement[i] = 0;
+        }
+    }
+
+    // takes the locations and shadow values from the shader's uniform table, which already reflected the linked
+    // program. The table is shared, so the bindings may outlive the shader object it was copied from
+    template <class ShaderType>
+    explicit ProgramBindings(const ShaderType &shader)
+        : ProgramBindings()
+    {
+        uniforms = shader.uniformTable();
+        for (unsigned int i = 0; i < Program::kUniformCount; i++)
+        {
+            const UniformId name(Program::kUniformNames[i]);
+            locations[i] = uniforms.location(name);
+            slots[i] = uniforms.slot(name);
+            // array elements aren't guaranteed consecutive locations or slots, so each is looked up
+            firstElement[i] = static_cast<unsigned int>(elementSlots.size());
+            if (Program::kUniformSizes[i] > 1)
+                for (GLint element = 0; element < Program::kUniformSizes[i]; element++)
+                    elementSlots.push_back(uniforms.slot(name[element]));
+            if (Program::kSamplerUnits[i] < 0)
+                continue;
+            const bool array = Program::kUniformSizes[i] > 1;
+            for (GLint element = 0; element < Program::kUniformSizes[i]; element++)
+            {
+                const GLint unit = Program::kSamplerUnits[i] + element;
+                GLint elementLocation = array ? uniforms.location(name[element]) : locations[i];
+                if (uniforms.changed(array ? elementSlots[firstElement[i] + element] : slots[i], GL_INT, &unit, sizeof(unit)))
+                    glProgramUniform1i(shader.ID, elementLocation, unit);
+            }
+        }
+        firstElement[Program::kUniformCount] = static_cast<unsigned int>(elementSlots.size());
+    }
+
+    GLint location(unsigned int index) const
+    {
+        return locations[index];
+    }
+
+    void set(UniformSlot<bool> slot, bool value) const
+    {
+        int v = (int)value;
+        if (changed(slot, GL_INT, &v, sizeof(v)))
+            glUniform1i(locations[slot.index], v);
+    }
+    void set(UniformSlot<int> slot, int value) const
+    {
+        if (changed(slot, GL_INT, &value, sizeof(value)))
+            glUniform1i(locations[slot.index], value);
+    }
+    void set(UniformSlot<float> slot, float value) const
+    {
+        if (changed(slot, GL_FLOAT, &value, sizeof(value)))
+            glUniform1f(locations[slot.index], value);
+    }
+    void set(UniformSlot<glm::vec2> slot, const glm::vec2 &value) const
+    {
+        if (changed(slot, GL_FLOAT_VEC2, &value[0], sizeof(float) * 2))
+            glUniform2fv(locations[slot.index], 1, &value[0]);
+    }
+    void set(UniformSlot<glm::vec3> slot, const glm::vec3 &value) const
+    {
+        if (changed(slot, GL_FLOAT_VEC3, &value[0], sizeof(float) * 3))
+            glUniform3fv(locations[slot.index], 1, &value[0]);
+    }
+    void set(UniformSlot<glm::vec4> slot, const glm::vec4 &value) const
+    {
+        if (changed(slot, GL_FLOAT_VEC4, &value[0], sizeof(float) * 4))
+            glUniform4fv(locations[slot.index], 1, &value[0]);
+    }
+    void set(UniformSlot<glm::mat2> slot, const glm::mat2 &mat) const
+    {
+        if (changed(slot, GL_FLOAT_MAT2, &mat[0][0], sizeof(float) * 4))
+            glUniformMatrix2fv(locations[slot.index], 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(UniformSlot<glm::mat3> slot, const glm::mat3 &mat) const
+    {
+        if (changed(slot, GL_FLOAT_MAT3, &mat[0][0], sizeof(float) * 9))
+            glUniformMatrix3fv(locations[slot.index], 1, GL_FALSE, &mat[0][0]);
+    }
+    void set(UniformSlot<glm::mat4> slot, const glm::mat4 &mat) const
+    {
+        if (changed(slot, GL_FLOAT_MAT4, &mat[0][0], sizeof(float) * 16))
+            glUniformMatrix4fv(locations[slot.index], 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // the first count elements of the array
+    void set(UniformArraySlot<int> slot, const int *values, GLsizei count) const         { glUniform1iv(locations[slot.index], uploaded(slot, count), values); }
+    void set(UniformArraySlot<float> slot, const float *values, GLsizei count) const     { glUniform1fv(locations[slot.index], uploaded(slot, count), values); }
+    void set(UniformArraySlot<glm::vec2> slot, const glm::vec2 *values, GLsizei count) const { glUniform2fv(locations[slot.index], uploaded(slot, count), &values[0][0]); }
+    void set(UniformArraySlot<glm::vec3> slot, const glm::vec3 *values, GLsizei count) const { glUniform3fv(locations[slot.index], uploaded(slot, count), &values[0][0]); }
+    void set(UniformArraySlot<glm::vec4> slot, const glm::vec4 *values, GLsizei count) const { glUniform4fv(locations[slot.index], uploaded(slot, count), &values[0][0]); }
+    void set(UniformArraySlot<glm::mat4> slot, const glm::mat4 *values, GLsizei count) const { glUniformMatrix4fv(locations[slot.index], uploaded(slot, count), GL_FALSE, &values[0][0][0]); }
+
+    // binds texture to the sampler's unit (element of a sampler array)
+    void bindTexture(SamplerSlot slot, GLenum target, GLuint texture, GLint element = 0) const
+    {
+        GLState::bindTexture(slot.unit + element, target, texture);
+    }
+
+private:
+    // next to each location the index of its shadow value in the shader's table, -1 where the program has none;
+    // arrays keep one per element in elementSlots, from firstElement of the uniform on
+    GLint locations[Program::kUniformCount + 1];
+    int slots[Program::kUniformCount + 1];
+    unsigned int firstElement[Program::kUniformCount + 1];
+    std::vector<int> elementSlots;
+    UniformTable uniforms;
+
+    template <class T>
+    bool changed(UniformSlot<T> slot, GLenum type, const void *value, size_t bytes) const
+    {
+        return uniforms.changed(slots[slot.index], type, value, bytes);
+    }
+
+    // the element count to upload, with the upload counted and the overwritten elements' shadow values forgotten
+    template <class T>
+    GLsizei uploaded(UniformArraySlot<T> slot, GLsizei count) const
+    {
+        count = clamp(slot, count);
+        const unsigned int first = firstElement[slot.index];
+        const unsigned int elements = std::min<unsigned int>(static_cast<unsigned int>(std::max<GLsizei>(count, 0)), firstElement[slot.index + 1] - first);
+        uniforms.issued(elementSlots.data() + first, elements);
+        return count;
+    }
+
+    template <class T>
+    static GLsizei clamp(UniformArraySlot<T> slot, GLsizei count)
+    {
+        if (count > slot.count)
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_ARRAY_OVERFLOW " << Program::kUniformNames[slot.index] << " holds " << slot.count << ", got " << count << std::endl;
+            return slot.count;
+        }
+        return count;
+    }
+};
+#endif
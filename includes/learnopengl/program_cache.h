@@ -0,0 +1,237 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ProgramCacheStatistics {
+    unsigned int hits = 0;       // programs created from a cached binary
+    unsigned int misses = 0;     // programs compiled from source one at a time while caching was on
+    unsigned int batched = 0;    // programs compiled from source through a ProgramBatch while caching was on
+    unsigned int rejected = 0;   // cached binaries the driver refused (driver update, corrupt file), compiled instead
+    double hitMilliseconds = 0.0;
+    double missMilliseconds = 0.0;
+    // batched compiles overlap each other and whatever the caller does meanwhile, so they aren't timed one by one:
+    // this is the wall time of each batch, from its first submit to the last of its programs taken
+    double batchMilliseconds = 0.0;
+};
+
+// opt-in on-disk cache of linked programs (glGetProgramBinary / glProgramBinary), so later runs skip compiling and
+// linking GLSL. A binary is keyed by a 64-bit hash of every stage's type and source (defines included, as they are
+// part of the source) and of the GL vendor, renderer and version strings, so a driver update or an edited shader
+// misses instead of loading something stale. A binary the driver still refuses is deleted and the program compiled
+// from source. Off until enable() is called; the Shader classes go through it on every construction.
+// everything here runs on the thread owning the GL context
+class ProgramCache
+{
+public:
+    // turns caching on with binaries kept in directory, which is created when missing
+    static void enable(const std::string &directory)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::DIRECTORY_NOT_CREATED " << directory << ": " << error.message() << std::endl;
+            return;
+        }
+        cacheDirectory() = directory;
+    }
+
+    static void disable()
+    {
+        cacheDirectory().clear();
+    }
+
+    static bool enabled()
+    {
+        return !cacheDirectory().empty();
+    }
+
+    // one program's trip through the cache: the sources are hashed on construction, then either load() finds the
+    // program or the caller compiles it, calling prepare() before glLinkProgram and store() after it.
+    // does nothing while caching is off
+    class Lookup
+    {
+    public:
+        explicit Lookup(const std::vector<std::pair<GLenum, const std::string*>> &stages)
+            : start(std::chrono::steady_clock::now()), active(enabled())
+        {
+            if (!active)
+                return;
+            for (const char *text : { glString(GL_VENDOR), glString(GL_RENDERER), glString(GL_VERSION) })
+                add(text, std::strlen(text) + 1);
+            for (const auto &stage : stages)
+            {
+                if (!stage.second)
+                    continue;
+                add(&stage.first, sizeof(stage.first));
+                add(stage.second->c_str(), stage.second->size() + 1);
+            }
+        }
+
+        // a linked program made from the cached binary, or 0 to compile from source
+        GLuint load()
+        {
+            if (!active)
+                return 0;
+            std::ifstream file(path(), std::ios::binary);
+            if (!file)
+                return 0;
+            Header header;
+            std::vector<char> binary;
+            if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) && std::memcmp(header.magic, kMagic, sizeof(header.magic)) == 0 && header.key == key)
+            {
+                binary.resize(header.length);
+                file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+            }
+            if (binary.empty() || !file)
+                return reject();
+
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked)
+            {
+                glDeleteProgram(program);
+                return reject();
+            }
+            statistics().hits++;
+            statistics().hitMilliseconds += elapsedMilliseconds();
+            return program;
+        }
+
+        // marks the program's binary as wanted, before it is linked
+        void prepare(GLuint program) const
+        {
+            if (active)
+                glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        // counts the program among the batched compiles, which ProgramBatch times as a whole, instead of timing it
+        void batch()
+        {
+            batched = true;
+        }
+
+        // writes the binary of the freshly linked program. Programs that failed to link aren't cached
+        void store(GLuint program)
+        {
+            if (!active)
+                return;
+            batched ? statistics().batched++ : statistics().misses++;
+            GLint linked = GL_FALSE, length = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (linked && length > 0)
+            {
+                Header header;
+                std::memcpy(header.magic, kMagic, sizeof(header.magic));
+                header.key = key;
+                std::vector<char> binary(static_cast<size_t>(length));
+                GLsizei written = 0;
+                glGetProgramBinary(program, length, &written, &header.format, binary.data());
+                header.length = static_cast<uint32_t>(written);
+                // written next to the final name and renamed, so a crash or a second instance never sees half a file
+                const std::string filename = path(), temporary = filename + ".tmp";
+                {
+                    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                    file.write(binary.data(), written);
+                }
+                std::error_code error;
+                std::filesystem::rename(temporary, filename, error);
+                if (written == 0 || error)
+                {
+                    std::filesystem::remove(temporary, error);
+                    std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << filename << std::endl;
+                }
+            }
+            if (!batched)
+                statistics().missMilliseconds += elapsedMilliseconds();
+        }
+
+    private:
+        struct Header {
+            char magic[8];
+            uint64_t key;
+            GLenum format;
+            uint32_t length;
+        };
+
+        std::chrono::steady_clock::time_point start;
+        bool active;
+        bool batched = false;
+        uint64_t key = 14695981039346656037ull; // 64-bit FNV-1a
+
+        void add(const void *data, size_t size)
+        {
+            const unsigned char *bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+                key = (key ^ bytes[i]) * 1099511628211ull;
+        }
+
+        std::string path() const
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+            return cacheDirectory() + '/' + name;
+        }
+
+        GLuint reject()
+        {
+            std::error_code error;
+            if (std::filesystem::remove(path(), error))
+                statistics().rejected++;
+            return 0;
+        }
+
+        double elapsedMilliseconds() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        static const char* glString(GLenum name)
+        {
+            const GLubyte *value = glGetString(name);
+            return value ? reinterpret_cast<const char*>(value) : "";
+        }
+    };
+
+    static ProgramCacheStatistics& statistics()
+    {
+        static ProgramCacheStatistics counts;
+        return counts;
+    }
+
+    // prints how many programs came from the cache and how long creating them took, against those compiled
+    static void report(std::ostream &out = std::cout)
+    {
+        const ProgramCacheStatistics &counts = statistics();
+        out << "PROGRAM_CACHE:: " << counts.hits << " programs from cache in " << counts.hitMilliseconds << " ms ("
+            << (counts.hits ? counts.hitMilliseconds / counts.hits : 0.0) << " ms each), " << counts.misses << " compiled in "
+            << counts.missMilliseconds << " ms (" << (counts.misses ? counts.missMilliseconds / counts.misses : 0.0) << " ms each), "
+            << counts.batched << " compiled in batches taking " << counts.batchMilliseconds << " ms, " << counts.rejected << " stale binaries rejected" << std::endl;
+    }
+
+private:
+    static constexpr char kMagic[8] = { 'L', 'O', 'G', 'L', 'P', 'R', 'G', '1' };
+
+    static std::string& cacheDirectory()
+    {
+        static std::string directory;
+        return directory;
+    }
+};
+#endif
@@ -0,0 +1,248 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cluster.h>
+#include <learnopengl/uniform_table.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// opaque draws go first, front to back so early depth testing rejects hidden fragments; transparent ones after them,
+// back to front so they blend over what is behind them
+enum RenderPass {
+    RENDER_PASS_OPAQUE      = 0,
+    RENDER_PASS_TRANSPARENT = 1
+};
+
+struct RenderQueueStatistics {
+    unsigned int packets = 0;
+    unsigned int programChanges = 0;  // glUseProgram between consecutive draws
+    unsigned int materialChanges = 0; // texture sets bound
+    unsigned int meshChanges = 0;     // vertex arrays switched
+    unsigned int triangles = 0;
+    unsigned int clustersTested = 0;
+    unsigned int clustersVisible = 0;
+    double sortMilliseconds = 0.0;
+};
+
+// one mesh to draw, as small as it gets: everything else is looked up from these when it is submitted.
+// the model matrix is read at submit time, so whatever owns it has to stay put until then
+struct DrawPacket {
+    GLuint program;
+    Mesh *mesh;
+    const glm::mat4 *model;
+    unsigned int lod;
+};
+
+// a program as the queue draws with it: its name and the uniform table of whichever shader class built it, with the
+// setters Mesh::Draw and the model matrix need. The table is shared with the shader, shadow values included
+struct QueuedProgram {
+    GLuint ID;
+    UniformTable uniforms;
+
+    void setInt(UniformId name, int value) const
+    {
+        GLint location = uniforms.changed(name, GL_INT, &value, sizeof(value));
+        if (location >= 0)
+            glUniform1i(location, value);
+    }
+
+    void setMat4(UniformId name, const glm::mat4 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT4, &mat[0][0], sizeof(float) * 16);
+        if (location >= 0)
+            glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+};
+
+// collects the draws of a frame, orders them by a 64-bit key and submits them in that order, so that draws sharing a
+// program, then a material, then a mesh follow each other and each state is set once per run instead of once per
+// draw. The opaque key, from the most significant bit down:
+//     pass (2) | program (10) | material (16) | mesh (16) | depth (20)
+// transparent draws put the inverted depth straight after the pass, as their order matters more than state changes.
+// depth is the distance to the camera, whose positive float bits already sort like the value; its top 20 bits are
+// kept. Programs get slots in the order they are first pushed each frame; the material key and vertex array name are
+// masked, which at worst splits a run in two. Keys are sorted with an LSD radix sort over bytes, skipping the bytes
+// every key shares. Draws are keyed on the program name, so any of the Shader classes (anything with an ID and a
+// uniformTable()) can push; the programs have to outlive the frame
+class RenderQueue
+{
+public:
+    // the frame's culling information, for meshes that cull their clusters at full detail
+    void begin(const Frustum &frustum, const glm::vec3 &cameraPosition)
+    {
+        packets.clear();
+        keys.clear();
+        programs.clear();
+        culling.frustum = frustum;
+        culling.cameraPosition = cameraPosition;
+    }
+
+    template <class ShaderType>
+    void push(const ShaderType &shader, Mesh &mesh, const glm::mat4 &model, unsigned int lod, float depth, RenderPass pass = RENDER_PASS_OPAQUE)
+    {
+        const uint64_t program = programSlot(shader) & 0x3FF;
+        const uint64_t material = mesh.material.sortKey() & 0xFFFF;
+        const uint64_t vertexArray = mesh.VAO & 0xFFFF;
+        const uint64_t distance = depthBits(depth);
+        uint64_t key = static_cast<uint64_t>(pass) << 62;
+        if (pass == RENDER_PASS_TRANSPARENT)
+            key |= (~distance & 0xFFFFF) << 42 | program << 32 | material << 16 | vertexArray;
+        else
+            key |= program << 52 | material << 36 | vertexArray << 20 | distance;
+
+        keys.push_back({ key, static_cast<uint32_t>(packets.size()) });
+        packets.push_back({ shader.ID, &mesh, &model, lod });
+    }
+
+    void sort()
+    {
+        auto start = chrono::steady_clock::now();
+        radixSort();
+        statistics.sortMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    // draws the packets in key order; sort() first
+    void submit()
+    {
+        statistics.packets = static_cast<unsigned int>(packets.size());
+        statistics.programChanges = statistics.materialChanges = statistics.meshChanges = 0;
+        statistics.triangles = statistics.clustersTested = statistics.clustersVisible = 0;
+        const QueuedProgram *program = nullptr;
+        uint32_t material = ~0u;
+        GLuint vertexArray = 0;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            const DrawPacket &packet = packets[keys[i].index];
+            if (!program || packet.program != program->ID)
+            {
+                program = &findProgram(packet.program);
+                GLState::useProgram(program->ID);
+                statistics.programChanges++;
+                material = ~0u;
+            }
+            if (packet.mesh->material.sortKey() != material)
+            {
+                material = packet.mesh->material.sortKey();
+                statistics.materialChanges++;
+            }
+            if (packet.mesh->VAO != vertexArray)
+            {
+                vertexArray = packet.mesh->VAO;
+                statistics.meshChanges++;
+            }
+            program->setMat4("model", *packet.model);
+            culling.model = *packet.model;
+            culling.clustersTested = culling.clustersVisible = 0;
+            statistics.triangles += packet.mesh->Draw(*program, packet.lod, &culling);
+            statistics.clustersTested += culling.clustersTested;
+            statistics.clustersVisible += culling.clustersVisible;
+        }
+    }
+
+    size_t size() const
+    {
+        return packets.size();
+    }
+
+    // the packets in submission order, once sorted
+    const DrawPacket& operator[](size_t i) const
+    {
+        return packets[keys[i].index];
+    }
+
+    uint64_t key(size_t i) const
+    {
+        return keys[i].key;
+    }
+
+    const RenderQueueStatistics& getStatistics() const
+    {
+        return statistics;
+    }
+
+    void report(ostream &out = cout) const
+    {
+        out << "RENDER_QUEUE:: " << statistics.packets << " draws, " << statistics.programChanges << " program, "
+            << statistics.materialChanges << " material and " << statistics.meshChanges << " mesh changes, sorted in "
+            << statistics.sortMilliseconds << " ms" << endl;
+    }
+
+private:
+    struct SortKey {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    vector<DrawPacket> packets;
+    vector<SortKey> keys, scratch;
+    vector<QueuedProgram> programs;
+    ClusterCulling culling;
+    RenderQueueStatistics statistics;
+
+    template <class ShaderType>
+    uint64_t programSlot(const ShaderType &shader)
+    {
+        for (size_t i = 0; i < programs.size(); i++)
+            if (programs[i].ID == shader.ID)
+                return i;
+        programs.push_back({ shader.ID, shader.uniformTable() });
+        return programs.size() - 1;
+    }
+
+    // programs only ever holds the few of a frame
+    const QueuedProgram& findProgram(GLuint program) const
+    {
+        size_t i = 0;
+        while (programs[i].ID != program)
+            i++;
+        return programs[i];
+    }
+
+    static uint64_t depthBits(float depth)
+    {
+        depth = depth > 0.0f ? depth : 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 12;
+    }
+
+    // stable, so draws with equal keys stay in the order they were pushed
+    void radixSort()
+    {
+        scratch.resize(keys.size());
+        uint64_t differing = 0;
+        for (const SortKey &key : keys)
+            differing |= key.key ^ keys[0].key;
+        for (unsigned int shift = 0; shift < 64; shift += 8)
+        {
+            if (((differing >> shift) & 0xFF) == 0)
+                continue;
+            size_t offsets[256] = {};
+            for (const SortKey &key : keys)
+                offsets[(key.key >> shift) & 0xFF]++;
+            size_t total = 0;
+            for (size_t &offset : offsets)
+            {
+                const size_t count = offset;
+                offset = total;
+                total += count;
+            }
+            for (const SortKey &key : keys)
+                scratch[offsets[(key.key >> shift) & 0xFF]++] = key;
+            keys.swap(scratch);
+        }
+    }
+};
+#endif
@@ -9,6 +9,11 @@
 #include <sstream>
 #include <iostream>
 
+#include <learnopengl/gl_state.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_source.h>
+#include <learnopengl/uniform_table.h>
+
 class ComputeShader
 {
 public:
@@ -17,111 +22,160 @@ public:
     // ------------------------------------------------------------------------
     ComputeShader(const char* computePath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string computeCode;
-        std::ifstream cShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            cShaderFile.open(computePath);
-
-            std::stringstream cShaderStream;
-            // read file's buffer contents into streams
-            cShaderStream << cShaderFile.rdbuf();
-            // close file handlers
-            cShaderFile.close();
-            // convert stream into string
-            computeCode = cShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
+        // 1. retrieve the source code from filePath, with #includes resolved
+        std::string computeCode = ShaderSource::load(computePath);
         const char* cShaderCode = computeCode.c_str();
-        // 2. compile shaders
-        unsigned int compute;
-        // compute shader
-        compute = glCreateShader(GL_COMPUTE_SHADER);
-        glShaderSource(compute, 1, &cShaderCode, NULL);
-        glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
+        // 2. take the program from the binary cache when it holds one, otherwise compile shaders
+        ProgramCache::Lookup cache({ { GL_COMPUTE_SHADER, &computeCode } });
+        ID = cache.load();
+        if (ID == 0)
+        {
+            unsigned int compute;
+            // compute shader
+            compute = glCreateShader(GL_COMPUTE_SHADER);
+            glShaderSource(compute, 1, &cShaderCode, NULL);
+            glCompileShader(compute);
+            checkCompileErrors(compute, "COMPUTE");
         
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, compute);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(compute);
+            // shader Program
+            ID = glCreateProgram();
+            glAttachShader(ID, compute);
+            cache.prepare(ID);
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+            cache.store(ID);
+            // delete the shaders as they're linked into our program now and no longer necessary
+            glDeleteShader(compute);
+        }
+        uniforms.build(ID);
+    }
+    // wraps a program that is linked already, such as one from ProgramBatch (ProgramHandle::get())
+    // ------------------------------------------------------------------------
+    explicit ComputeShader(GLuint program)
+        : ID(program)
+    {
+        uniforms.build(ID);
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::useProgram(ID); 
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformId name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        int v = (int)value;
+        GLint location = uniforms.changed(name, GL_INT, &v, sizeof(v));
+        if (location >= 0)
+            glUniform1i(location, v);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformId name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        GLint location = uniforms.changed(name, GL_INT, &value, sizeof(value));
+        if (location >= 0)
+            glUniform1i(location, value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformId name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        GLint location = uniforms.changed(name, GL_FLOAT, &value, sizeof(value));
+        if (location >= 0)
+            glUniform1f(location, value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformId name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC2, &value[0], sizeof(float) * 2);
+        if (location >= 0)
+            glUniform2fv(location, 1, &value[0]);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(UniformId name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        const float v[] = { x, y };
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC2, v, sizeof(v));
+        if (location >= 0)
+            glUniform2f(location, x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformId name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC3, &value[0], sizeof(float) * 3);
+        if (location >= 0)
+            glUniform3fv(location, 1, &value[0]);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(UniformId name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        const float v[] = { x, y, z };
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC3, v, sizeof(v));
+        if (location >= 0)
+            glUniform3f(location, x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformId name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC4, &value[0], sizeof(float) * 4);
+        if (location >= 0)
+            glUniform4fv(location, 1, &value[0]);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
+    void setVec4(UniformId name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        const float v[] = { x, y, z, w };
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC4, v, sizeof(v));
+        if (location >= 0)
+            glUniform4f(location, x, y, z, w);
+    }
+    // ------------------------------------------------------------------------
+    void setMat2(UniformId name, const glm::mat2 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT2, &mat[0][0], sizeof(float) * 4);
+        if (location >= 0)
+            glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat3(UniformId name, const glm::mat3 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT3, &mat[0][0], sizeof(float) * 9);
+        if (location >= 0)
+            glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(UniformId name, const glm::mat4 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT4, &mat[0][0], sizeof(float) * 16);
+        if (location >= 0)
+            glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // location of a uniform from the table read at link time, -1 when the program has no such active uniform
+    // ------------------------------------------------------------------------
+    GLint uniformLocation(UniformId name) const
+    {
+        return uniforms.location(name);
     }
+    // forgets the values the setters skip unchanged uniforms by; call after setting uniforms of the program directly
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void invalidateUniforms()
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        uniforms.invalidate();
     }
+    // every active uniform of the program, for tools and debugging
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    const std::vector<UniformInfo>& activeUniforms() const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        return uniforms.activeUniforms();
     }
+    // the uniform table with its shadow values, for setters that look uniforms up once (ProgramBindings)
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    const UniformTable& uniformTable() const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        return uniforms;
     }
 
 private:
+    UniformTable uniforms;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
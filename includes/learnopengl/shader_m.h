@@ -9,6 +9,11 @@
 #include <sstream>
 #include <iostream>
 
+#include <learnopengl/gl_state.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_source.h>
+#include <learnopengl/uniform_table.h>
+
 class Shader
 {
 public:
@@ -17,125 +22,168 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
+        // 1. retrieve the source code from filePath, with #includes resolved
+        std::string vertexCode = ShaderSource::load(vertexPath);
+        std::string fragmentCode = ShaderSource::load(fragmentPath);
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
+        // 2. take the program from the binary cache when it holds one, otherwise compile shaders
+        ProgramCache::Lookup cache({ { GL_VERTEX_SHADER, &vertexCode }, { GL_FRAGMENT_SHADER, &fragmentCode } });
+        ID = cache.load();
+        if (ID == 0)
+        {
+            unsigned int vertex, fragment;
+            // vertex shader
+            vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glCompileShader(vertex);
+            checkCompileErrors(vertex, "VERTEX");
+            // fragment Shader
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+            // shader Program
+            ID = glCreateProgram();
+            glAttachShader(ID, vertex);
+            glAttachShader(ID, fragment);
+            cache.prepare(ID);
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+            cache.store(ID);
+            // delete the shaders as they're linked into our program now and no longer necessary
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+        }
+        uniforms.build(ID);
+    }
+    // wraps a program that is linked already, such as one from ProgramBatch (ProgramHandle::get())
+    // ------------------------------------------------------------------------
+    explicit Shader(GLuint program)
+        : ID(program)
+    {
+        uniforms.build(ID);
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     { 
-        glUseProgram(ID); 
+        GLState::useProgram(ID); 
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformId name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        int v = (int)value;
+        GLint location = uniforms.changed(name, GL_INT, &v, sizeof(v));
+        if (location >= 0)
+            glUniform1i(location, v);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformId name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        GLint location = uniforms.changed(name, GL_INT, &value, sizeof(value));
+        if (location >= 0)
+            glUniform1i(location, value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformId name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        GLint location = uniforms.changed(name, GL_FLOAT, &value, sizeof(value));
+        if (location >= 0)
+            glUniform1f(location, value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformId name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC2, &value[0], sizeof(float) * 2);
+        if (location >= 0)
+            glUniform2fv(location, 1, &value[0]);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(UniformId name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        const float v[] = { x, y };
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC2, v, sizeof(v));
+        if (location >= 0)
+            glUniform2f(location, x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformId name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC3, &value[0], sizeof(float) * 3);
+        if (location >= 0)
+            glUniform3fv(location, 1, &value[0]);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(UniformId name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        const float v[] = { x, y, z };
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC3, v, sizeof(v));
+        if (location >= 0)
+            glUniform3f(location, x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformId name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC4, &value[0], sizeof(float) * 4);
+        if (location >= 0)
+            glUniform4fv(location, 1, &value[0]);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    void setVec4(UniformId name, float x, float y, float z, float w) const
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        const float v[] = { x, y, z, w };
+        GLint location = uniforms.changed(name, GL_FLOAT_VEC4, v, sizeof(v));
+        if (location >= 0)
+            glUniform4f(location, x, y, z, w);
+    }
+    // ------------------------------------------------------------------------
+    void setMat2(UniformId name, const glm::mat2 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT2, &mat[0][0], sizeof(float) * 4);
+        if (location >= 0)
+            glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat3(UniformId name, const glm::mat3 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT3, &mat[0][0], sizeof(float) * 9);
+        if (location >= 0)
+            glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(UniformId name, const glm::mat4 &mat) const
+    {
+        GLint location = uniforms.changed(name, GL_FLOAT_MAT4, &mat[0][0], sizeof(float) * 16);
+        if (location >= 0)
+            glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // location of a uniform from the table read at link time, -1 when the program has no such active uniform
+    // ------------------------------------------------------------------------
+    GLint uniformLocation(UniformId name) const
+    {
+        return uniforms.location(name);
     }
+    // forgets the values the setters skip unchanged uniforms by; call after setting uniforms of the program directly
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void invalidateUniforms()
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        uniforms.invalidate();
     }
+    // every active uniform of the program, for tools and debugging
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    const std::vector<UniformInfo>& activeUniforms() const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        return uniforms.activeUniforms();
     }
+    // the uniform table with its shadow values, for setters that look uniforms up once (ProgramBindings)
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    const UniformTable& uniformTable() const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        return uniforms;
     }
 
 private:
+    UniformTable uniforms;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
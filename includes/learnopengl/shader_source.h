@@ -0,0 +1,174 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+// #defines put in front of a shader's source, one set per variant: ShaderDefines().set("SKINNED").set("MAX_BONES", 100).
+// kept sorted by name, so the same set gives the same key() whatever order it was built in
+class ShaderDefines
+{
+public:
+    ShaderDefines& set(const std::string &name, const std::string &value = "1")
+    {
+        values[name] = value;
+        return *this;
+    }
+
+    ShaderDefines& set(const std::string &name, int value)
+    {
+        return set(name, std::to_string(value));
+    }
+
+    bool empty() const
+    {
+        return values.empty();
+    }
+
+    // "MAX_BONES=100 SKINNED=1", what variants are told apart by
+    std::string key() const
+    {
+        std::string text;
+        for (const auto &value : values)
+            text += (text.empty() ? "" : " ") + value.first + '=' + value.second;
+        return text;
+    }
+
+    // the #define lines
+    std::string text() const
+    {
+        std::string lines;
+        for (const auto &value : values)
+            lines += "#define " + value.first + ' ' + value.second + '\n';
+        return lines;
+    }
+
+private:
+    std::map<std::string, std::string> values;
+};
+
+// reads GLSL the way the Shader classes need it. #include "file" lines are replaced by that file, found relative to the
+// file including it; each file is pasted once per shader (as with #pragma once), which also stops include cycles.
+// #line directives keep compile errors pointing at the right line, with the source string number being the file's
+// position in the order files were first opened (0 is the shader itself). defines go straight after #version.
+// besides files on disk, #include finds sources registered with addFile(), such as blocks generated from C++ structs
+class ShaderSource
+{
+public:
+    // makes text includable as #include "name" from any shader, ahead of files on disk
+    static void addFile(const std::string &name, const std::string &text)
+    {
+        registered()[name] = text;
+    }
+
+    static std::string load(const std::string &path, const ShaderDefines &defines = ShaderDefines())
+    {
+        std::set<std::string> included;
+        int files = 0;
+        std::string source = expand(path, included, files);
+
+        if (defines.empty())
+            return source;
+        // #version has to stay the first line, so the defines come after it and numbering picks up again behind them
+        if (source.compare(0, 8, "#version") == 0)
+        {
+            size_t end = source.find('\n');
+            std::string version = end == std::string::npos ? source + '\n' : source.substr(0, end + 1);
+            std::string rest = end == std::string::npos ? std::string() : source.substr(end + 1);
+            return version + defines.text() + "#line 2 0\n" + rest;
+        }
+        return defines.text() + "#line 1 0\n" + source;
+    }
+
+private:
+    static std::string expand(const std::string &path, std::set<std::string> &included, int &files)
+    {
+        const int file = files++;
+        included.insert(path);
+        std::string code;
+        if (!read(path, code))
+            return std::string();
+        if (code.find("#include") == std::string::npos)
+            return code;
+
+        const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        std::istringstream lines(code);
+        std::string line, result;
+        for (int number = 1; std::getline(lines, line); number++)
+        {
+            std::string name;
+            if (!includeName(line, name))
+            {
+                result += line + '\n';
+                continue;
+            }
+            // registered sources go by their name alone, files by their path relative to this one
+            const std::string includePath = registered().count(name) ? name : directory + name;
+            if (included.count(includePath) == 0)
+            {
+                if (registered().count(includePath) || std::ifstream(includePath))
+                {
+                    result += "#line 1 " + std::to_string(files) + '\n';
+                    result += expand(includePath, included, files);
+                    if (!result.empty() && result.back() != '\n')
+                        result += '\n';
+                }
+                else
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << includePath << " (included from " << path << ")" << std::endl;
+                }
+            }
+            result += "#line " + std::to_string(number + 1) + ' ' + std::to_string(file) + '\n';
+        }
+        return result;
+    }
+
+    static bool read(const std::string &path, std::string &code)
+    {
+        auto found = registered().find(path);
+        if (found != registered().end())
+        {
+            code = found->second;
+            return true;
+        }
+        std::ifstream shaderFile;
+        shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            shaderFile.open(path);
+            std::stringstream shaderStream;
+            shaderStream << shaderFile.rdbuf();
+            code = shaderStream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << ": " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static std::map<std::string, std::string>& registered()
+    {
+        static std::map<std::string, std::string> files;
+        return files;
+    }
+
+    // the file of an #include "file" line
+    static bool includeName(const std::string &line, std::string &name)
+    {
+        size_t at = line.find_first_not_of(" \t");
+        if (at == std::string::npos || line.compare(at, 8, "#include") != 0)
+            return false;
+        size_t open = line.find('"', at + 8), close = open == std::string::npos ? open : line.find('"', open + 1);
+        if (close == std::string::npos)
+            return false;
+        name = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+};
+#endif
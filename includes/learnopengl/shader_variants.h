@@ -0,0 +1,111 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <learnopengl/program_batch.h>
+#include <learnopengl/shader_source.h>
+
+struct ShaderVariantStatistics {
+    unsigned int variants = 0;      // variants built or being built
+    unsigned int failed = 0;        // variants that didn't compile or link
+    double compileMilliseconds = 0.0; // main thread time spent submitting and waiting for variants
+};
+
+// the specialized programs of one set of shader files: every set of defines (SKINNED, NORMALMAP, MAX_BONES=N, ...)
+// gives its own program, compiled with only the code that variant needs instead of branching on uniforms in one
+// uber-shader. get() builds a variant the first time it is asked for; prewarm() submits a list of them to the driver
+// up front, through a ProgramBatch, so they compile while the level loads. Programs also go through the ProgramCache.
+// ShaderType is whichever Shader class the demo includes (anything with an explicit ShaderType(GLuint program))
+template <class ShaderType>
+class ShaderVariants
+{
+public:
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
+    {
+    }
+
+    // the variant for defines, compiling it first if no earlier get() or prewarm() asked for it
+    ShaderType& get(const ShaderDefines &defines = ShaderDefines())
+    {
+        Variant &variant = submit(defines);
+        if (!variant.shader)
+        {
+            auto start = std::chrono::steady_clock::now();
+            variant.shader.reset(new ShaderType(variant.handle.get()));
+            statistics.compileMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (variant.shader->ID == 0)
+            {
+                statistics.failed++;
+                std::cout << "ERROR::SHADER::VARIANT_FAILED: " << vertexPath << " [" << defines.key() << "]" << std::endl;
+            }
+        }
+        return *variant.shader;
+    }
+
+    // submits every variant in the list that isn't built yet, without waiting for any of them
+    void prewarm(const std::vector<ShaderDefines> &variants)
+    {
+        for (const ShaderDefines &defines : variants)
+            submit(defines);
+    }
+
+    bool contains(const ShaderDefines &defines) const
+    {
+        return cache.count(defines.key()) != 0;
+    }
+
+    const ShaderVariantStatistics& getStatistics() const
+    {
+        return statistics;
+    }
+
+    // prints how many variants exist and what they cost to compile
+    void report(std::ostream &out = std::cout) const
+    {
+        out << "SHADER_VARIANTS:: " << vertexPath << ", " << fragmentPath << ": " << statistics.variants << " variants ("
+            << statistics.failed << " failed), " << statistics.compileMilliseconds << " ms compiling" << std::endl;
+        for (const auto &variant : cache)
+            out << "    [" << variant.first << "]" << (variant.second.shader ? "" : " (pending)") << std::endl;
+    }
+
+private:
+    struct Variant {
+        ProgramHandle handle;
+        std::unique_ptr<ShaderType> shader;
+    };
+
+    std::string vertexPath, fragmentPath, geometryPath;
+    std::map<std::string, Variant> cache;
+    ProgramBatch batch;
+    ShaderVariantStatistics statistics;
+
+    Variant& submit(const ShaderDefines &defines)
+    {
+        auto found = cache.find(defines.key());
+        if (found != cache.end())
+            return found->second;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::pair<GLenum, std::string>> sources;
+        sources.emplace_back(GL_VERTEX_SHADER, ShaderSource::load(vertexPath, defines));
+        sources.emplace_back(GL_FRAGMENT_SHADER, ShaderSource::load(fragmentPath, defines));
+        if (!geometryPath.empty())
+            sources.emplace_back(GL_GEOMETRY_SHADER, ShaderSource::load(geometryPath, defines));
+        Variant &variant = cache[defines.key()];
+        variant.handle = batch.submit(sources);
+        statistics.variants++;
+        statistics.compileMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return variant;
+    }
+};
+#endif
@@ -0,0 +1,68 @@
+#ifndef STD140_H
+#define STD140_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// base alignment and size of the GLSL types a std140 uniform block can hold, as the C++ types mirroring them.
+// vec3 is aligned like vec4 but only 12 bytes long, so a scalar may follow in its last 4 bytes
+template <class T> struct Std140;
+template <> struct Std140<float>     { static constexpr size_t alignment = 4,  size = 4;  };
+template <> struct Std140<int>       { static constexpr size_t alignment = 4,  size = 4;  };
+template <> struct Std140<glm::vec2> { static constexpr size_t alignment = 8,  size = 8;  };
+template <> struct Std140<glm::vec3> { static constexpr size_t alignment = 16, size = 12; };
+template <> struct Std140<glm::vec4> { static constexpr size_t alignment = 16, size = 16; };
+template <> struct Std140<glm::mat4> { static constexpr size_t alignment = 16, size = 64; };
+
+// where std140 puts a member of type T that follows a member ending at offset end
+template <class T>
+constexpr size_t std140Offset(size_t end)
+{
+    return (end + Std140<T>::alignment - 1) / Std140<T>::alignment * Std140<T>::alignment;
+}
+
+// compile time check that member of the C++ mirror of a block sits where std140 places it after previous
+#define STD140_MEMBER(Block, previous, member) \
+    static_assert(offsetof(Block, member) == std140Offset<decltype(Block::member)>(offsetof(Block, previous) + Std140<decltype(Block::previous)>::size), \
+                  #Block "::" #member " is not at its std140 offset")
+
+// run time check of the same against what the driver made of the GLSL block: every member's offset and the block's
+// size. members are (GLSL name, C++ offset) pairs; prints what doesn't match and returns false. A block the program
+// doesn't use is fine
+inline bool checkStd140Block(GLuint program, const std::string &block, size_t size, const std::vector<std::pair<std::string, size_t>> &members)
+{
+    GLuint index = glGetUniformBlockIndex(program, block.c_str());
+    if (index == GL_INVALID_INDEX)
+        return true;
+    bool matches = true;
+    GLint dataSize = 0;
+    glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+    if (static_cast<size_t>(dataSize) != size)
+    {
+        std::cout << "ERROR::STD140::BLOCK_SIZE " << block << " is " << dataSize << " bytes in GLSL, " << size << " in C++" << std::endl;
+        matches = false;
+    }
+    for (const auto &member : members)
+    {
+        const GLchar *name = member.first.c_str();
+        GLuint uniform = GL_INVALID_INDEX;
+        glGetUniformIndices(program, 1, &name, &uniform);
+        if (uniform == GL_INVALID_INDEX)
+            continue; // optimized out
+        GLint offset = -1;
+        glGetActiveUniformsiv(program, 1, &uniform, GL_UNIFORM_OFFSET, &offset);
+        if (static_cast<size_t>(offset) != member.second)
+        {
+            std::cout << "ERROR::STD140::MEMBER_OFFSET " << member.first << " is at " << offset << " in GLSL, " << member.second << " in C++" << std::endl;
+            matches = false;
+        }
+    }
+    return matches;
+}
+#endif
@@ -0,0 +1,874 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// S3TC isn't part of core GL and our glad doesn't load EXT_texture_compression_s3tc, but every desktop driver exposes it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// how a texture is sampled decides its block format
+enum TextureUsage {
+    TEXTURE_USAGE_COLOR,  // BC1 for RGB, BC7 for RGBA (BC3 when preferBC3 or the context lacks BC7), BC4 for single channel
+    TEXTURE_USAGE_NORMAL  // BC5 with only X and Y stored; shaders must rebuild Z = sqrt(1 - x*x - y*y) from the unpacked [-1, 1] values
+};
+
+enum BlockFormat {
+    BLOCK_FORMAT_NONE,
+    BLOCK_FORMAT_BC1,
+    BLOCK_FORMAT_BC3,
+    BLOCK_FORMAT_BC4,
+    BLOCK_FORMAT_BC5,
+    BLOCK_FORMAT_BC7
+};
+
+// a block compressed texture with its full mip chain, as stored in the cooked cache
+struct CompressedImage {
+    BlockFormat format = BLOCK_FORMAT_NONE;
+    int width = 0;
+    int height = 0;
+    vector<vector<unsigned char>> levels; // level 0 first
+
+    bool empty() const
+    {
+        return levels.empty();
+    }
+};
+
+inline const char* blockFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+        case BLOCK_FORMAT_BC1: return "BC1";
+        case BLOCK_FORMAT_BC3: return "BC3";
+        case BLOCK_FORMAT_BC4: return "BC4";
+        case BLOCK_FORMAT_BC5: return "BC5";
+        case BLOCK_FORMAT_BC7: return "BC7";
+        default: return "uncompressed";
+    }
+}
+
+struct TextureCompressionReport {
+    string path;
+    BlockFormat format = BLOCK_FORMAT_NONE;
+    int width = 0;
+    int height = 0;
+    unsigned int levels = 0;
+    size_t uncompressedBytes = 0;
+    size_t compressedBytes = 0;
+    double psnr = 0.0;    // of level 0 over the channels the format stores, in dB
+    double seconds = 0.0; // mip generation and encoding
+
+    void print(std::ostream &out = std::cout) const
+    {
+        out << "TEXTURE_COMPRESSOR:: " << path << " " << width << "x" << height << " " << blockFormatName(format)
+            << ", " << levels << " levels, " << uncompressedBytes / 1024 << " KiB -> " << compressedBytes / 1024 << " KiB, PSNR "
+            << psnr << " dB, " << seconds * 1000.0 << " ms (" << (seconds > 0.0 ? width * height / seconds / 1e6 : 0.0) << " MPix/s)" << std::endl;
+    }
+};
+
+// CPU encoders for the BCn block formats, and the KTX2 container the cooked textures are cached in.
+// every encoder works on one 4x4 block of RGBA8 texels (edge blocks replicate the last row/column) and picks its
+// endpoints along the principal axis of the block's colors, then refines them with one least squares pass.
+// BC7 uses mode 6 only (one subset, RGBA endpoints with p-bits, 4-bit indices), which handles smooth color and alpha well.
+// the inner loops are plain fixed-size float loops the compiler vectorizes; blocks rows are spread over the worker pool.
+class TextureCompressor
+{
+public:
+    static inline bool preferBC3 = false; // encode RGBA color textures as BC3 instead of the slower but better BC7
+
+    static BlockFormat chooseFormat(int components, TextureUsage usage)
+    {
+        if (usage == TEXTURE_USAGE_NORMAL)
+            return BLOCK_FORMAT_BC5;
+        if (components == 1)
+            return BLOCK_FORMAT_BC4;
+        if (components == 4)
+            return preferBC3 || !supportsBC7() ? BLOCK_FORMAT_BC3 : BLOCK_FORMAT_BC7;
+        return BLOCK_FORMAT_BC1;
+    }
+
+    // whether the context can sample BC7 (BPTC): core since GL 4.2 and an extension before, which macOS' 4.1 context
+    // doesn't have. Asked once and remembered; the first call has to come from the thread owning the context
+    static bool supportsBC7()
+    {
+        static const bool supported = GLAD_GL_VERSION_4_2 || hasExtension("GL_ARB_texture_compression_bptc");
+        return supported;
+    }
+
+    // whether textures in format can be uploaded to this context
+    static bool supported(BlockFormat format)
+    {
+        return format != BLOCK_FORMAT_BC7 || supportsBC7();
+    }
+
+    static unsigned int blockBytes(BlockFormat format)
+    {
+        return format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4 ? 8 : 16;
+    }
+
+    static size_t levelBytes(BlockFormat format, int width, int height)
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+
+    static GLenum glFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+            case BLOCK_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case BLOCK_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case BLOCK_FORMAT_BC4: return GL_COMPRESSED_RED_RGTC1;
+            case BLOCK_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+            case BLOCK_FORMAT_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            default: return 0;
+        }
+    }
+
+    // encodes one mip level given as tightly packed RGBA8
+    static vector<unsigned char> encode(const unsigned char *rgba, int width, int height, BlockFormat format)
+    {
+        const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        const unsigned int bytes = blockBytes(format);
+        vector<unsigned char> encoded(static_cast<size_t>(blocksX) * blocksY * bytes);
+        ThreadPool::shared().parallelFor(static_cast<size_t>(blocksY), [&](size_t by) {
+            unsigned char block[64];
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                loadBlock(rgba, width, height, bx, static_cast<int>(by), block);
+                encodeBlock(block, format, &encoded[(by * blocksX + bx) * bytes]);
+            }
+        });
+        return encoded;
+    }
+
+    // decodes one level back to RGBA8, used to measure the encoding error
+    static vector<unsigned char> decode(const unsigned char *encoded, int width, int height, BlockFormat format)
+    {
+        const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        const unsigned int bytes = blockBytes(format);
+        vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+        unsigned char block[64];
+        for (int by = 0; by < blocksY; by++)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                decodeBlock(&encoded[(static_cast<size_t>(by) * blocksX + bx) * bytes], format, block);
+                for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                    for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                        memcpy(&rgba[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+            }
+        }
+        return rgba;
+    }
+
+    // peak signal to noise ratio between two RGBA8 images over the channels the format stores
+    static double psnr(const unsigned char *reference, const unsigned char *test, int width, int height, BlockFormat format)
+    {
+        const int channels = format == BLOCK_FORMAT_BC4 ? 1 : format == BLOCK_FORMAT_BC5 ? 2 : format == BLOCK_FORMAT_BC1 ? 3 : 4;
+        double squared = 0.0;
+        const size_t texels = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < texels; i++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                const double d = double(reference[i * 4 + c]) - double(test[i * 4 + c]);
+                squared += d * d;
+            }
+        }
+        const double mse = squared / (texels * channels);
+        return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    }
+
+    // writes the image as a KTX2 file (no supercompression, smallest level first in the file as the spec asks)
+    static bool writeKtx2(const string &filename, const CompressedImage &image)
+    {
+        const uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+        const vector<uint32_t> dfd = dataFormatDescriptor(image.format);
+        const uint32_t dfdOffset = 80 + 24 * levelCount;
+        const uint32_t dfdBytes = static_cast<uint32_t>(dfd.size() * 4);
+
+        vector<uint64_t> offsets(levelCount);
+        uint64_t offset = dfdOffset + dfdBytes;
+        for (uint32_t i = levelCount; i-- > 0; )
+        {
+            offset = (offset + 15) / 16 * 16;
+            offsets[i] = offset;
+            offset += image.levels[i].size();
+        }
+
+        std::ofstream file(filename, std::ios::binary);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(kKtx2Identifier), sizeof(kKtx2Identifier));
+        const uint32_t header[] = { vkFormat(image.format), 1, static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), 0, 0, 1, levelCount, 0,
+                                    dfdOffset, dfdBytes, 0, 0 };
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        const uint64_t supercompression[] = { 0, 0 };
+        file.write(reinterpret_cast<const char*>(supercompression), sizeof(supercompression));
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            const uint64_t level[] = { offsets[i], image.levels[i].size(), image.levels[i].size() };
+            file.write(reinterpret_cast<const char*>(level), sizeof(level));
+        }
+        file.write(reinterpret_cast<const char*>(dfd.data()), dfdBytes);
+        uint64_t written = dfdOffset + dfdBytes;
+        for (uint32_t i = levelCount; i-- > 0; )
+        {
+            static const char zeros[16] = {};
+            file.write(zeros, static_cast<std::streamsize>(offsets[i] - written));
+            file.write(reinterpret_cast<const char*>(image.levels[i].data()), image.levels[i].size());
+            written = offsets[i] + image.levels[i].size();
+        }
+        return static_cast<bool>(file);
+    }
+
+    // reads a KTX2 file written by writeKtx2 (or any uncompressed-supercompression 2D KTX2 in a BCn format we upload)
+    static bool readKtx2(const string &filename, CompressedImage &image)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+            return false;
+        unsigned char identifier[12];
+        uint32_t header[13];
+        uint64_t supercompression[2];
+        file.read(reinterpret_cast<char*>(identifier), sizeof(identifier));
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        file.read(reinterpret_cast<char*>(supercompression), sizeof(supercompression));
+        if (!file || memcmp(identifier, kKtx2Identifier, sizeof(identifier)) != 0)
+            return false;
+
+        const BlockFormat format = blockFormat(header[0]);
+        const uint32_t levelCount = std::max<uint32_t>(header[7], 1);
+        // 2D, one layer, one face, no supercompression
+        if (format == BLOCK_FORMAT_NONE || header[4] > 1 || header[5] > 1 || header[6] != 1 || header[8] != 0)
+        {
+            std::cout << "ERROR::TEXTURE_COMPRESSOR::UNSUPPORTED_KTX2 " << filename << std::endl;
+            return false;
+        }
+
+        image.format = format;
+        image.width = static_cast<int>(header[2]);
+        image.height = static_cast<int>(std::max<uint32_t>(header[3], 1));
+        vector<uint64_t> index(levelCount * 3);
+        file.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(uint64_t));
+        image.levels.assign(levelCount, vector<unsigned char>());
+        for (uint32_t i = 0; i < levelCount && file; i++)
+        {
+            const int w = std::max(1, image.width >> i), h = std::max(1, image.height >> i);
+            if (index[i * 3 + 1] != levelBytes(format, w, h))
+                return false;
+            image.levels[i].resize(index[i * 3 + 1]);
+            file.seekg(static_cast<std::streamoff>(index[i * 3]));
+            file.read(reinterpret_cast<char*>(image.levels[i].data()), image.levels[i].size());
+        }
+        return static_cast<bool>(file);
+    }
+
+private:
+    static bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const GLubyte *extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+            if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static constexpr unsigned char kKtx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    static uint32_t vkFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+            case BLOCK_FORMAT_BC1: return 131; // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+            case BLOCK_FORMAT_BC3: return 137; // VK_FORMAT_BC3_UNORM_BLOCK
+            case BLOCK_FORMAT_BC4: return 139; // VK_FORMAT_BC4_UNORM_BLOCK
+            case BLOCK_FORMAT_BC5: return 141; // VK_FORMAT_BC5_UNORM_BLOCK
+            case BLOCK_FORMAT_BC7: return 145; // VK_FORMAT_BC7_UNORM_BLOCK
+            default: return 0;
+        }
+    }
+
+    static BlockFormat blockFormat(uint32_t vk)
+    {
+        switch (vk)
+        {
+            case 131: case 133: return BLOCK_FORMAT_BC1;
+            case 137: return BLOCK_FORMAT_BC3;
+            case 139: return BLOCK_FORMAT_BC4;
+            case 141: return BLOCK_FORMAT_BC5;
+            case 145: return BLOCK_FORMAT_BC7;
+            default: return BLOCK_FORMAT_NONE;
+        }
+    }
+
+    // Khronos basic data format descriptor of a BCn format: one sample per 64-bit half of the block
+    static vector<uint32_t> dataFormatDescriptor(BlockFormat format)
+    {
+        // {bit offset, bit length - 1, channel id}
+        vector<uint32_t> samples;
+        uint32_t colorModel = 0;
+        switch (format)
+        {
+            case BLOCK_FORMAT_BC1: colorModel = 128; samples = { 0, 63, 0 }; break;
+            case BLOCK_FORMAT_BC3: colorModel = 130; samples = { 0, 63, 15, 64, 63, 0 }; break;
+            case BLOCK_FORMAT_BC4: colorModel = 131; samples = { 0, 63, 0 }; break;
+            case BLOCK_FORMAT_BC5: colorModel = 132; samples = { 0, 63, 0, 64, 63, 1 }; break;
+            case BLOCK_FORMAT_BC7: colorModel = 134; samples = { 0, 127, 0 }; break;
+            default: break;
+        }
+        const uint32_t sampleCount = static_cast<uint32_t>(samples.size() / 3);
+        const uint32_t blockSize = 24 + 16 * sampleCount;
+        vector<uint32_t> dfd;
+        dfd.push_back(4 + blockSize);               // total size
+        dfd.push_back(0);                           // vendor Khronos, descriptor type basic
+        dfd.push_back(2 | (blockSize << 16));       // version 1.3, block size
+        dfd.push_back(colorModel | (1 << 8) | (1 << 16)); // BT.709 primaries, linear transfer, straight alpha
+        dfd.push_back(3 | (3 << 8));                // 4x4x1x1 texel blocks
+        dfd.push_back(blockBytes(format));          // bytes in plane 0
+        dfd.push_back(0);
+        for (uint32_t s = 0; s < sampleCount; s++)
+        {
+            dfd.push_back(samples[s * 3] | (samples[s * 3 + 1] << 16) | (samples[s * 3 + 2] << 24));
+            dfd.push_back(0);          // sample position
+            dfd.push_back(0);          // lower
+            dfd.push_back(0xFFFFFFFF); // upper
+        }
+        return dfd;
+    }
+
+    static void loadBlock(const unsigned char *rgba, int width, int height, int bx, int by, unsigned char block[64])
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            const int sy = std::min(by * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++)
+            {
+                const int sx = std::min(bx * 4 + x, width - 1);
+                memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+            }
+        }
+    }
+
+    static void encodeBlock(const unsigned char block[64], BlockFormat format, unsigned char *out)
+    {
+        switch (format)
+        {
+            case BLOCK_FORMAT_BC1:
+                encodeBC1(block, out);
+                break;
+            case BLOCK_FORMAT_BC3:
+                encodeBC4(block, 3, out);
+                encodeBC1(block, out + 8);
+                break;
+            case BLOCK_FORMAT_BC4:
+                encodeBC4(block, 0, out);
+                break;
+            case BLOCK_FORMAT_BC5:
+                encodeBC4(block, 0, out);
+                encodeBC4(block, 1, out + 8);
+                break;
+            case BLOCK_FORMAT_BC7:
+                encodeBC7(block, out);
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void decodeBlock(const unsigned char *in, BlockFormat format, unsigned char block[64])
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            block[i * 4 + 0] = block[i * 4 + 1] = block[i * 4 + 2] = 0;
+            block[i * 4 + 3] = 255;
+        }
+        switch (format)
+        {
+            case BLOCK_FORMAT_BC1:
+                decodeBC1(in, block);
+                break;
+            case BLOCK_FORMAT_BC3:
+                decodeBC1(in + 8, block);
+                decodeBC4(in, 3, block);
+                break;
+            case BLOCK_FORMAT_BC4:
+                decodeBC4(in, 0, block);
+                break;
+            case BLOCK_FORMAT_BC5:
+                decodeBC4(in, 0, block);
+                decodeBC4(in + 8, 1, block);
+                break;
+            case BLOCK_FORMAT_BC7:
+                decodeBC7(in, block);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // principal axis of the block's points in N dimensions, by power iteration on the covariance matrix
+    template <int N>
+    static void principalAxis(const float points[16][N], float mean[N], float axis[N])
+    {
+        for (int c = 0; c < N; c++)
+        {
+            mean[c] = 0.0f;
+            for (int i = 0; i < 16; i++)
+                mean[c] += points[i][c];
+            mean[c] /= 16.0f;
+        }
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; i++)
+            for (int a = 0; a < N; a++)
+                for (int b = 0; b < N; b++)
+                    covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+        for (int c = 0; c < N; c++)
+            axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[N] = {};
+            float length = 0.0f;
+            for (int a = 0; a < N; a++)
+            {
+                for (int b = 0; b < N; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length = std::max(length, std::abs(next[a]));
+            }
+            if (length <= 0.0f)
+                break;
+            for (int c = 0; c < N; c++)
+                axis[c] = next[c] / length;
+        }
+    }
+
+    // endpoints of the block's extent along its principal axis
+    template <int N>
+    static void boundingEndpoints(const float points[16][N], float e0[N], float e1[N])
+    {
+        float mean[N], axis[N];
+        principalAxis<N>(points, mean, axis);
+        float minT = 1e30f, maxT = -1e30f;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; c++)
+                t += (points[i][c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        float axisLength2 = 0.0f;
+        for (int c = 0; c < N; c++)
+            axisLength2 += axis[c] * axis[c];
+        const float scale = axisLength2 > 0.0f ? 1.0f / axisLength2 : 0.0f;
+        for (int c = 0; c < N; c++)
+        {
+            e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT * scale));
+            e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT * scale));
+        }
+    }
+
+    // least squares endpoints for fixed interpolation weights t[i] in [0, 1] (0 = e0). False if degenerate
+    template <int N>
+    static bool fitEndpoints(const float points[16][N], const float t[16], float e0[N], float e1[N])
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[N] = {}, bx[N] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            const float a = 1.0f - t[i], b = t[i];
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < N; c++)
+            {
+                ax[c] += a * points[i][c];
+                bx[c] += b * points[i][c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+            return false;
+        for (int c = 0; c < N; c++)
+        {
+            e0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+            e1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+        }
+        return true;
+    }
+
+    static unsigned short pack565(const float c[3])
+    {
+        const int r = static_cast<int>(c[0] * 31.0f / 255.0f + 0.5f);
+        const int g = static_cast<int>(c[1] * 63.0f / 255.0f + 0.5f);
+        const int b = static_cast<int>(c[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<unsigned short>((r << 11) | (g << 5) | b);
+    }
+
+    static void unpack565(unsigned short packed, int c[3])
+    {
+        const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        c[0] = (r << 3) | (r >> 2);
+        c[1] = (g << 2) | (g >> 4);
+        c[2] = (b << 3) | (b >> 2);
+    }
+
+    // four-color palette of a BC1 block with color0 > color1
+    static void bc1Palette(unsigned short c0, unsigned short c1, int palette[4][3])
+    {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    // chooses the nearest palette entry per texel and returns the total squared error
+    static int bc1Indices(const float points[16][3], unsigned short c0, unsigned short c1, unsigned int &bits)
+    {
+        int palette[4][3];
+        bc1Palette(c0, c1, palette);
+        int total = 0;
+        bits = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    const int d = static_cast<int>(points[i][c]) - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            total += bestError;
+            bits |= static_cast<unsigned int>(best) << (2 * i);
+        }
+        return total;
+    }
+
+    // BC1 in four-color mode (also the color half of BC3, which is always decoded that way)
+    static void encodeBC1(const unsigned char block[64], unsigned char out[8])
+    {
+        float points[16][3];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                points[i][c] = block[i * 4 + c];
+
+        float e0[3], e1[3];
+        boundingEndpoints<3>(points, e0, e1);
+        unsigned short c0 = pack565(e0), c1 = pack565(e1);
+        unsigned int bits = 0;
+        int error = 1 << 30;
+        if (c0 != c1)
+        {
+            if (c0 < c1)
+                std::swap(c0, c1);
+            error = bc1Indices(points, c0, c1, bits);
+
+            // refit the endpoints to the chosen indices
+            static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+            float t[16];
+            for (int i = 0; i < 16; i++)
+                t[i] = weights[(bits >> (2 * i)) & 3];
+            if (fitEndpoints<3>(points, t, e0, e1))
+            {
+                unsigned short r0 = pack565(e0), r1 = pack565(e1);
+                if (r0 < r1)
+                    std::swap(r0, r1);
+                unsigned int refined;
+                if (r0 != r1)
+                {
+                    const int refinedError = bc1Indices(points, r0, r1, refined);
+                    if (refinedError < error)
+                    {
+                        error = refinedError;
+                        c0 = r0;
+                        c1 = r1;
+                        bits = refined;
+                    }
+                }
+            }
+        }
+        if (c0 == c1)
+            bits = 0; // single color: every index points at color0
+
+        out[0] = c0 & 0xFF;
+        out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF;
+        out[3] = c1 >> 8;
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (bits >> (8 * i)) & 0xFF;
+    }
+
+    static void decodeBC1(const unsigned char in[8], unsigned char block[64])
+    {
+        const unsigned short c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+        int palette[4][3];
+        bc1Palette(c0, c1, palette);
+        if (c0 <= c1)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        const unsigned int bits = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<unsigned int>(in[7]) << 24);
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                block[i * 4 + c] = static_cast<unsigned char>(palette[(bits >> (2 * i)) & 3][c]);
+    }
+
+    // eight-value palette of a BC4 block with e0 > e1
+    static void bc4Palette(int e0, int e1, int palette[8])
+    {
+        palette[0] = e0;
+        palette[1] = e1;
+        if (e0 > e1)
+        {
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * e0 + i * e1) / 7;
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * e0 + i * e1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // one channel of the block as BC4 (also the alpha half of BC3 and each half of BC5)
+    static void encodeBC4(const unsigned char block[64], int channel, unsigned char out[8])
+    {
+        int minValue = 255, maxValue = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            minValue = std::min<int>(minValue, block[i * 4 + channel]);
+            maxValue = std::max<int>(maxValue, block[i * 4 + channel]);
+        }
+        out[0] = static_cast<unsigned char>(maxValue);
+        out[1] = static_cast<unsigned char>(minValue);
+        uint64_t bits = 0;
+        if (maxValue > minValue)
+        {
+            int palette[8];
+            bc4Palette(maxValue, minValue, palette);
+            for (int i = 0; i < 16; i++)
+            {
+                const int value = block[i * 4 + channel];
+                int best = 0;
+                for (int p = 1; p < 8; p++)
+                    if (std::abs(palette[p] - value) < std::abs(palette[best] - value))
+                        best = p;
+                bits |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (bits >> (8 * i)) & 0xFF;
+    }
+
+    static void decodeBC4(const unsigned char in[8], int channel, unsigned char block[64])
+    {
+        int palette[8];
+        bc4Palette(in[0], in[1], palette);
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; i++)
+            bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+        for (int i = 0; i < 16; i++)
+            block[i * 4 + channel] = static_cast<unsigned char>(palette[(bits >> (3 * i)) & 7]);
+    }
+
+    static const int* bc7Weights()
+    {
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        return weights;
+    }
+
+    // quantizes an endpoint to 7 bits per channel plus the shared p-bit that suits it best
+    static void bc7QuantizeEndpoint(const float e[4], int quantized[4], int &pbit)
+    {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; p++)
+        {
+            float error = 0.0f;
+            int q[4];
+            for (int c = 0; c < 4; c++)
+            {
+                q[c] = std::min(127, std::max(0, static_cast<int>((e[c] - p) / 2.0f + 0.5f)));
+                const float d = ((q[c] << 1) | p) - e[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbit = p;
+                for (int c = 0; c < 4; c++)
+                    quantized[c] = q[c];
+            }
+        }
+    }
+
+    static int bc7Indices(const float points[16][4], const int q0[4], int p0, const int q1[4], int p1, int indices[16])
+    {
+        const int *weights = bc7Weights();
+        int palette[16][4];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                palette[i][c] = ((64 - weights[i]) * ((q0[c] << 1) | p0) + weights[i] * ((q1[c] << 1) | p1) + 32) >> 6;
+        int total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 16; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    const int d = static_cast<int>(points[i][c]) - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices[i] = best;
+            total += bestError;
+        }
+        return total;
+    }
+
+    static void putBits(unsigned char out[16], int &position, unsigned int value, int count)
+    {
+        for (int i = 0; i < count; i++, position++)
+            if ((value >> i) & 1)
+                out[position >> 3] |= static_cast<unsigned char>(1 << (position & 7));
+    }
+
+    static unsigned int getBits(const unsigned char in[16], int &position, int count)
+    {
+        unsigned int value = 0;
+        for (int i = 0; i < count; i++, position++)
+            value |= static_cast<unsigned int>((in[position >> 3] >> (position & 7)) & 1) << i;
+        return value;
+    }
+
+    // BC7 mode 6
+    static void encodeBC7(const unsigned char block[64], unsigned char out[16])
+    {
+        float points[16][4];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                points[i][c] = block[i * 4 + c];
+
+        float e0[4], e1[4];
+        boundingEndpoints<4>(points, e0, e1);
+        int q0[4], q1[4], p0, p1, indices[16];
+        bc7QuantizeEndpoint(e0, q0, p0);
+        bc7QuantizeEndpoint(e1, q1, p1);
+        int error = bc7Indices(points, q0, p0, q1, p1, indices);
+
+        float t[16];
+        for (int i = 0; i < 16; i++)
+            t[i] = bc7Weights()[indices[i]] / 64.0f;
+        if (fitEndpoints<4>(points, t, e0, e1))
+        {
+            int r0[4], r1[4], rp0, rp1, refined[16];
+            bc7QuantizeEndpoint(e0, r0, rp0);
+            bc7QuantizeEndpoint(e1, r1, rp1);
+            const int refinedError = bc7Indices(points, r0, rp0, r1, rp1, refined);
+            if (refinedError < error)
+            {
+                std::copy(r0, r0 + 4, q0);
+                std::copy(r1, r1 + 4, q1);
+                p0 = rp0;
+                p1 = rp1;
+                std::copy(refined, refined + 16, indices);
+            }
+        }
+
+        // the first index is stored without its top bit, so it must be below 8: swap the endpoints if it isn't
+        if (indices[0] & 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(q0[c], q1[c]);
+            std::swap(p0, p1);
+            for (int i = 0; i < 16; i++)
+                indices[i] = 15 - indices[i];
+        }
+
+        memset(out, 0, 16);
+        int position = 0;
+        putBits(out, position, 1 << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            putBits(out, position, q0[c], 7);
+            putBits(out, position, q1[c], 7);
+        }
+        putBits(out, position, p0, 1);
+        putBits(out, position, p1, 1);
+        putBits(out, position, indices[0], 3);
+        for (int i = 1; i < 16; i++)
+            putBits(out, position, indices[i], 4);
+    }
+
+    static void decodeBC7(const unsigned char in[16], unsigned char block[64])
+    {
+        int position = 0;
+        if (getBits(in, position, 7) != (1 << 6))
+            return; // only mode 6 is ever written by encodeBC7
+        int e[2][4];
+        for (int c = 0; c < 4; c++)
+        {
+            e[0][c] = getBits(in, position, 7) << 1;
+            e[1][c] = getBits(in, position, 7) << 1;
+        }
+        const int p0 = getBits(in, position, 1), p1 = getBits(in, position, 1);
+        for (int c = 0; c < 4; c++)
+        {
+            e[0][c] |= p0;
+            e[1][c] |= p1;
+        }
+        const int *weights = bc7Weights();
+        for (int i = 0; i < 16; i++)
+        {
+            const int index = getBits(in, position, i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; c++)
+                block[i * 4 + c] = static_cast<unsigned char>(((64 - weights[index]) * e[0][c] + weights[index] * e[1][c] + 32) >> 6);
+        }
+    }
+};
+#endif
@@ -0,0 +1,466 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mip_builder.h>
+#include <learnopengl/pixel_pool.h>
+#include <learnopengl/texture_compressor.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/upload_queue.h>
+
+#include <chrono>
+#include <climits>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// an image decoded into client memory, waiting for its GL upload. Owns data, a pool buffer (or an stb_image allocation
+// when pool is null). When a cooked block compressed version was found, compressed holds it with all its mips instead of data
+struct DecodedImage {
+    string path;
+    unsigned char *data = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    vector<vector<unsigned char>> mips; // levels 1.. of data when built on the CPU (TextureLoader::generateMips)
+    CompressedImage compressed;
+    PixelPool *pool = nullptr; // data goes back here on release
+    size_t capacity = 0;       // of the pool buffer
+
+    DecodedImage() = default;
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+    DecodedImage(DecodedImage &&other) noexcept
+        : path(std::move(other.path)), data(other.data), width(other.width), height(other.height), components(other.components), mips(std::move(other.mips)), compressed(std::move(other.compressed)),
+          pool(other.pool), capacity(other.capacity)
+    {
+        other.data = nullptr;
+        other.pool = nullptr;
+    }
+    DecodedImage& operator=(DecodedImage &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            path = std::move(other.path);
+            data = other.data;
+            width = other.width;
+            height = other.height;
+            components = other.components;
+            mips = std::move(other.mips);
+            compressed = std::move(other.compressed);
+            pool = other.pool;
+            capacity = other.capacity;
+            other.data = nullptr;
+            other.pool = nullptr;
+        }
+        return *this;
+    }
+    ~DecodedImage()
+    {
+        release();
+    }
+
+    bool valid() const
+    {
+        return data || !compressed.empty();
+    }
+
+    void release()
+    {
+        if (pool)
+            pool->release(data, capacity);
+        else if (data)
+            stbi_image_free(data);
+        data = nullptr;
+        pool = nullptr;
+        mips.clear();
+    }
+};
+
+// splits texture loading into a CPU stage (file read + decode) that is safe on any thread and
+// a GL stage that must run on the thread owning the context.
+class TextureLoader
+{
+public:
+    // reads and decodes directory/path. A cooked directory/path.ktx2 that is at least as new as the source is read
+    // instead when useCache is set. The file is memory mapped and decoded into a PixelPool::shared() buffer (see
+    // decodeInto), and JPEGs with restart markers decode across the worker pool (see stb_image's
+    // stbi_load_from_memory_parallel). Thread safe as long as no one changes stb_image's global flags meanwhile, and
+    // once TextureCompressor::supportsBC7() was asked on the context thread (decodeAll does). Caches in a format the
+    // context can't sample, BC7 cooked elsewhere, are passed over for the source
+    static DecodedImage decode(const string &path, const string &directory, bool useCache = true)
+    {
+        DecodedImage image;
+        image.path = path;
+        string filename = directory + '/' + path;
+        if (useCache && cacheIsFresh(filename) && TextureCompressor::readKtx2(cachePath(filename), image.compressed)
+            && TextureCompressor::supported(image.compressed.format))
+        {
+            image.width = image.compressed.width;
+            image.height = image.compressed.height;
+            return image;
+        }
+        image.compressed = CompressedImage();
+        MappedFile file(filename);
+        int width, height, components;
+        if (info(file, width, height, components))
+        {
+            PixelPool &pool = PixelPool::shared();
+            size_t capacity;
+            unsigned char *pixels = pool.acquire(static_cast<size_t>(width) * height * components, capacity);
+            if (decodeInto(file, pixels, capacity, image.width, image.height, image.components))
+            {
+                image.data = pixels;
+                image.pool = &pool;
+                image.capacity = capacity;
+            }
+            else
+                pool.release(pixels, capacity);
+        }
+        if (!image.data)
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+        return image;
+    }
+
+    // reads width, height and channel count of directory/path from its header, to size the memory for decodeInto()
+    static bool imageInfo(const string &path, const string &directory, int &width, int &height, int &components)
+    {
+        return info(MappedFile(directory + '/' + path), width, height, components);
+    }
+
+    // decodes directory/path into destination, capacity bytes of memory the caller owns (a mapped pixel unpack buffer,
+    // a staging arena) that must hold width * height * components as imageInfo() reports them. The file is mapped
+    // rather than read and JPEGs and 8-bit PNGs decode straight into destination, so neither the file nor the image
+    // is copied through a buffer of its own. Never reads a cooked .ktx2. Thread safe like decode()
+    static bool decodeInto(const string &path, const string &directory, unsigned char *destination, size_t capacity, int &width, int &height, int &components)
+    {
+        return decodeInto(MappedFile(directory + '/' + path), destination, capacity, width, height, components);
+    }
+
+    // builds the mip chain of a decoded image on the CPU, so upload() doesn't leave it to glGenerateMipmap's box filter.
+    // srgb filters color in linear light, for textures holding gamma encoded color. Thread safe
+    static void generateMips(DecodedImage &image, bool srgb)
+    {
+        if (!image.data || (image.width == 1 && image.height == 1))
+            return;
+        image.mips = buildMipLevels(image.data, image.width, image.height, image.components, 1, srgb);
+    }
+
+    static GLenum pixelFormat(int components)
+    {
+        if (components == 1)
+            return GL_RED;
+        if (components == 2)
+            return GL_RG;
+        if (components == 3)
+            return GL_RGB;
+        return GL_RGBA;
+    }
+
+    // creates a mipmapped, repeating 2D texture from a decoded image. Must be called on the context thread.
+    // a failed decode still yields a valid (empty) texture name, like TextureFromFile always did.
+    // texels keep a linear internal format, sRGB or not; gamma encoded color only changes how the mips are filtered
+    // (generateMips), so shaders see the same values with and without gamma correction
+    static unsigned int upload(const DecodedImage &image)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (!image.valid())
+            return textureID;
+
+        GLState::bindTextureForUpdate(GL_TEXTURE_2D, textureID);
+        if (!image.compressed.empty())
+        {
+            // the cooked mips go up as they are, no conversion or mipmap generation in the driver
+            const CompressedImage &compressed = image.compressed;
+            const GLenum format = TextureCompressor::glFormat(compressed.format);
+            for (size_t level = 0; level < compressed.levels.size(); level++)
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, std::max(1, compressed.width >> level), std::max(1, compressed.height >> level),
+                                       0, static_cast<GLsizei>(compressed.levels[level].size()), compressed.levels[level].data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(compressed.levels.size()) - 1);
+        }
+        else
+        {
+            const GLenum format = pixelFormat(image.components);
+            // the CPU built mips are tightly packed; odd widths of RGB levels aren't 4-byte aligned
+            GLint alignment;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+            for (size_t level = 1; level <= image.mips.size(); level++)
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, std::max(1, image.width >> level), std::max(1, image.height >> level),
+                             0, format, GL_UNSIGNED_BYTE, image.mips[level - 1].data());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+            if (image.mips.empty())
+                glGenerateMipmap(GL_TEXTURE_2D);
+            else
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size()));
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
+    // like upload(), but only allocates the texture here and leaves the texel transfer (and any mipmap generation) to the
+    // upload queue, which streams it in over the next frames. The texture samples as undefined until then
+    static unsigned int uploadAsync(DecodedImage image, UploadQueue &uploads)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (!image.valid())
+            return textureID;
+
+        GLState::bindTextureForUpdate(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        auto owner = make_shared<DecodedImage>(std::move(image));
+        if (!owner->compressed.empty())
+        {
+            const CompressedImage &compressed = owner->compressed;
+            const GLenum format = TextureCompressor::glFormat(compressed.format);
+            for (size_t level = 0; level < compressed.levels.size(); level++)
+            {
+                const int w = std::max(1, compressed.width >> level), h = std::max(1, compressed.height >> level);
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, w, h, 0, static_cast<GLsizei>(compressed.levels[level].size()), nullptr);
+                uploads.enqueueCompressedTexture(textureID, static_cast<int>(level), w, h, format, TextureCompressor::blockBytes(compressed.format), compressed.levels[level].data(), owner);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(compressed.levels.size()) - 1);
+            return textureID;
+        }
+
+        const GLenum format = pixelFormat(owner->components);
+        const bool generateMipmap = owner->mips.empty();
+        for (size_t level = 0; level <= owner->mips.size(); level++)
+        {
+            const int w = std::max(1, owner->width >> level), h = std::max(1, owner->height >> level);
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, w, h, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            const unsigned char *pixels = level == 0 ? owner->data : owner->mips[level - 1].data();
+            uploads.enqueueTexture(textureID, static_cast<int>(level), w, h, format, owner->components, generateMipmap, pixels, owner);
+        }
+        if (!generateMipmap)
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(owner->mips.size()));
+        return textureID;
+    }
+
+    // GPU memory of the texture upload() makes from an image, including its mip chain. Drivers pad RGB to RGBA
+    static size_t textureBytes(const DecodedImage &image)
+    {
+        if (!image.compressed.empty())
+        {
+            size_t bytes = 0;
+            for (const vector<unsigned char> &level : image.compressed.levels)
+                bytes += level.size();
+            return bytes;
+        }
+        if (!image.data)
+            return 0;
+        const size_t texelBytes = image.components == 3 ? 4 : static_cast<size_t>(image.components);
+        return static_cast<size_t>(image.width) * image.height * texelBytes * 4 / 3;
+    }
+
+    // decodes every path on the shared worker pool, runs prepare(index, DecodedImage) on the worker as well, and hands the
+    // results in order to consume(index, result) on the calling thread. At most kMaxDecodesInFlight images per worker
+    // are held in memory at once, so hundreds of 4K textures don't need to be decoded side by side.
+    template <typename Prepare, typename Consume>
+    static void decodeAll(const vector<string> &paths, const string &directory, Prepare prepare, Consume consume, bool useCache = true)
+    {
+        typedef typename std::invoke_result<Prepare, size_t, DecodedImage>::type Prepared;
+        TextureCompressor::supportsBC7(); // decode() asks on the workers
+        ThreadPool &pool = ThreadPool::shared();
+        const size_t maxInFlight = static_cast<size_t>(pool.size()) * kMaxDecodesInFlight;
+
+        deque<future<Prepared>> pending;
+        size_t next = 0;
+        for (size_t done = 0; done < paths.size(); done++)
+        {
+            while (next < paths.size() && pending.size() < maxInFlight)
+            {
+                const size_t index = next++;
+                pending.push_back(pool.submit([index, &paths, &directory, &prepare, useCache] { return prepare(index, decode(paths[index], directory, useCache)); }));
+            }
+            Prepared prepared = pending.front().get();
+            pending.pop_front();
+            consume(done, std::move(prepared));
+        }
+    }
+
+    // decodes the paths in parallel while the calling (context) thread uploads the finished images in order.
+    // Returns one texture per path, and their textureBytes() in bytes when given.
+    // With an upload queue the GL transfers are streamed through it instead.
+    // the mip chains are built on the workers too; in linear light for the paths srgb flags, or for all of them when only gamma is given
+    static vector<unsigned int> loadAll(const vector<string> &paths, const string &directory, bool gamma = false, vector<size_t> *bytes = nullptr, UploadQueue *uploads = nullptr,
+                                        const vector<bool> *srgb = nullptr)
+    {
+        vector<unsigned int> textureIDs;
+        textureIDs.reserve(paths.size());
+        decodeAll(paths, directory, [gamma, srgb](size_t index, DecodedImage image) {
+            generateMips(image, srgb ? (*srgb)[index] : gamma);
+            return image;
+        }, [&](size_t, DecodedImage image) {
+            if (bytes)
+                bytes->push_back(textureBytes(image));
+            textureIDs.push_back(uploads ? uploadAsync(std::move(image), *uploads) : upload(image));
+        });
+        return textureIDs;
+    }
+
+    // Kaiser filtered mip chain of tightly packed 8-bit pixels, returning levels >= firstLevel. See MipBuilder
+    static vector<vector<unsigned char>> buildMipLevels(const unsigned char *pixels, int width, int height, int components, int firstLevel = 0, bool srgb = false)
+    {
+        return MipBuilder::build(pixels, width, height, components, srgb, firstLevel);
+    }
+
+    // times decoding directory/path images from memory with stb_image's SIMD and wide-word paths (JPEG kernels, PNG
+    // unfiltering and inflate) and with its plain byte-wise code, and prints megapixels per second of both plus the largest
+    // difference between their pixels. Switches stb globally, so nothing else may decode meanwhile
+    static void benchmarkDecode(const vector<string> &paths, const string &directory, int repeats = 3, std::ostream &out = std::cout)
+    {
+        vector<vector<unsigned char>> files;
+        for (const string &path : paths)
+        {
+            MappedFile file(directory + '/' + path);
+            if (file.empty())
+                std::cout << "ERROR::TEXTURE_LOADER::BENCHMARK_READ_FAILED " << path << std::endl;
+            else
+                files.emplace_back(file.data(), file.data() + file.size()); // decode timings shouldn't include page faults
+        }
+
+        double megapixels = 0.0;
+        auto run = [&](bool simd, vector<vector<unsigned char>> &pixels) {
+            stbi_set_simd(simd);
+            megapixels = 0.0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; r++)
+                for (const vector<unsigned char> &file : files)
+                {
+                    int w, h, c;
+                    unsigned char *data = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &w, &h, &c, 0);
+                    if (!data)
+                        continue;
+                    megapixels += double(w) * h / 1e6;
+                    if (r == 0)
+                        pixels.emplace_back(data, data + static_cast<size_t>(w) * h * c);
+                    stbi_image_free(data);
+                }
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        vector<vector<unsigned char>> reference, fast;
+        const double scalarSeconds = run(false, reference);
+        const double simdSeconds = run(true, fast);
+
+        int maxDifference = 0;
+        for (size_t i = 0; i < reference.size() && i < fast.size(); i++)
+            for (size_t p = 0; p < reference[i].size(); p++)
+                maxDifference = std::max(maxDifference, std::abs(int(reference[i][p]) - int(fast[i][p])));
+        out << "TEXTURE_LOADER:: decoded " << files.size() << " images (" << megapixels / repeats << " MPix) x " << repeats
+            << ": SIMD " << megapixels / simdSeconds << " MPix/s, scalar: " << megapixels / scalarSeconds << " MPix/s ("
+            << scalarSeconds / simdSeconds << "x), max difference " << maxDifference << std::endl;
+    }
+
+    static string cachePath(const string &filename)
+    {
+        return filename + ".ktx2";
+    }
+
+    // a cache is used when it exists and the source is missing (shipped cooked only) or not newer than it
+    static bool cacheIsFresh(const string &filename)
+    {
+        std::error_code error;
+        const auto cached = std::filesystem::last_write_time(cachePath(filename), error);
+        if (error)
+            return false;
+        const auto source = std::filesystem::last_write_time(filename, error);
+        return error || source <= cached;
+    }
+
+    // offline cook step: decodes directory/path, builds its mip chain, block compresses every level in the format the
+    // usage calls for and writes directory/path.ktx2, which decode() then picks up. Reports size, PSNR and speed.
+    // srgb builds the mips in linear light, for color textures a gamma correct renderer samples
+    static TextureCompressionReport cook(const string &path, const string &directory, TextureUsage usage = TEXTURE_USAGE_COLOR, bool srgb = false)
+    {
+        TextureCompressionReport report;
+        report.path = path;
+        DecodedImage image = decode(path, directory, false);
+        if (!image.data)
+            return report;
+
+        const auto start = std::chrono::steady_clock::now();
+        // the encoders take RGBA; missing channels are zero, alpha opaque
+        vector<unsigned char> rgba(static_cast<size_t>(image.width) * image.height * 4);
+        for (size_t i = 0; i < static_cast<size_t>(image.width) * image.height; i++)
+        {
+            for (int c = 0; c < 4; c++)
+                rgba[i * 4 + c] = c < image.components ? image.data[i * image.components + c] : (c == 3 ? 255 : 0);
+            if (image.components == 1 && usage != TEXTURE_USAGE_NORMAL)
+                rgba[i * 4 + 1] = rgba[i * 4 + 2] = rgba[i * 4];
+        }
+        vector<vector<unsigned char>> mips = buildMipLevels(rgba.data(), image.width, image.height, 4, 0, srgb && usage == TEXTURE_USAGE_COLOR);
+
+        CompressedImage compressed;
+        compressed.format = TextureCompressor::chooseFormat(image.components, usage);
+        compressed.width = image.width;
+        compressed.height = image.height;
+        for (size_t level = 0; level < mips.size(); level++)
+            compressed.levels.push_back(TextureCompressor::encode(mips[level].data(), std::max(1, image.width >> level), std::max(1, image.height >> level), compressed.format));
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const vector<unsigned char> decoded = TextureCompressor::decode(compressed.levels[0].data(), image.width, image.height, compressed.format);
+        report.psnr = TextureCompressor::psnr(rgba.data(), decoded.data(), image.width, image.height, compressed.format);
+        report.format = compressed.format;
+        report.width = image.width;
+        report.height = image.height;
+        report.levels = static_cast<unsigned int>(compressed.levels.size());
+        report.uncompressedBytes = textureBytes(image);
+        image.release();
+        image.compressed = std::move(compressed);
+        report.compressedBytes = textureBytes(image);
+
+        if (!TextureCompressor::writeKtx2(cachePath(directory + '/' + path), image.compressed))
+            std::cout << "ERROR::TEXTURE_LOADER::CACHE_WRITE_FAILED " << cachePath(directory + '/' + path) << std::endl;
+        return report;
+    }
+
+private:
+    static const unsigned int kMaxDecodesInFlight = 2;
+
+    // stb_image takes the length as an int, files of 2 GB and more are left alone
+    static bool info(const MappedFile &file, int &width, int &height, int &components)
+    {
+        if (file.empty() || file.size() > static_cast<size_t>(INT_MAX))
+            return false;
+        return stbi_info_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &components) != 0;
+    }
+
+    // asks for the channel count the header reports, so the image in destination always has the size info() gives
+    static bool decodeInto(const MappedFile &file, unsigned char *destination, size_t capacity, int &width, int &height, int &components)
+    {
+        int fileComponents;
+        if (!info(file, width, height, components))
+            return false;
+        return stbi_load_from_memory_into(file.data(), static_cast<int>(file.size()), &width, &height, &fileComponents, components, destination, capacity, stbParallelFor, nullptr) != 0;
+    }
+
+    // stb_image's parallel JPEG decode runs its jobs on the shared pool, also when decode() itself runs on a worker
+    static void stbParallelFor(void *, int count, void (*job)(void *jobData, int index), void *jobData)
+    {
+        ThreadPool::shared().parallelFor(static_cast<size_t>(count), [job, jobData](size_t i) { job(jobData, static_cast<int>(i)); });
+    }
+};
+#endif
@@ -0,0 +1,160 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+struct TextureRegistryStatistics {
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    size_t residentTextures = 0;
+    size_t residentBytes = 0;
+
+    void print(std::ostream &out = std::cout) const
+    {
+        const unsigned long long lookups = hits + misses;
+        out << "TEXTURE_REGISTRY:: " << residentTextures << " textures resident ("
+            << residentBytes / (1024 * 1024) << " MiB), " << hits << " hits / " << misses << " misses ("
+            << (lookups ? 100.0 * hits / lookups : 0.0) << "% hit rate)" << std::endl;
+    }
+};
+
+// process-wide table of the GL textures loaded from files, shared between every Model that references them.
+// keyed by normalized file path; each acquire/insert takes a reference and the GL texture is deleted when
+// the last reference is released. Only used from the thread owning the GL context, so it takes no locks.
+class TextureRegistry
+{
+public:
+    // turns directory/path into a canonical key: forward slashes, no "." segments and ".." folded where possible
+    static string normalizePath(const string &path)
+    {
+        string slashed = path;
+        for (char &c : slashed)
+            if (c == '\\')
+                c = '/';
+
+        const bool absolute = !slashed.empty() && slashed[0] == '/';
+        vector<string> segments;
+        size_t begin = 0;
+        while (begin <= slashed.size())
+        {
+            size_t end = slashed.find('/', begin);
+            if (end == string::npos)
+                end = slashed.size();
+            string segment = slashed.substr(begin, end - begin);
+            if (segment == "..")
+            {
+                if (!segments.empty() && segments.back() != "..")
+                    segments.pop_back();
+                else if (!absolute)
+                    segments.push_back(segment);
+            }
+            else if (!segment.empty() && segment != ".")
+                segments.push_back(segment);
+            begin = end + 1;
+        }
+
+        string normalized = absolute ? "/" : "";
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            if (i > 0)
+                normalized += '/';
+            normalized += segments[i];
+        }
+        return normalized;
+    }
+
+    // looks a texture up and takes a reference to it on a hit
+    static bool acquire(const string &key, unsigned int &textureID)
+    {
+        Registry &registry = instance();
+        auto entry = registry.entries.find(key);
+        if (entry == registry.entries.end())
+        {
+            registry.statistics.misses++;
+            return false;
+        }
+        registry.statistics.hits++;
+        entry->second.references++;
+        textureID = entry->second.textureID;
+        return true;
+    }
+
+    // registers a texture that was just created for key, holding one reference, and returns the texture to use for key.
+    // bytes is the GPU memory it occupies and is only used for reporting. When key is already registered, the
+    // registered texture wins: it gains the reference and is returned, and textureID is deleted
+    static unsigned int insert(const string &key, unsigned int textureID, size_t bytes)
+    {
+        Registry &registry = instance();
+        Entry &entry = registry.entries[key];
+        if (entry.references > 0)
+        {
+            // someone registered the same file meanwhile: keep theirs, drop the duplicate
+            std::cout << "WARNING::TEXTURE_REGISTRY::DUPLICATE_INSERT " << key << std::endl;
+            glDeleteTextures(1, &textureID);
+            GLState::forgetTexture(textureID);
+            entry.references++;
+            return entry.textureID;
+        }
+        entry.textureID = textureID;
+        entry.references = 1;
+        entry.bytes = bytes;
+        registry.keys[textureID] = key;
+        registry.statistics.residentTextures++;
+        registry.statistics.residentBytes += bytes;
+        return textureID;
+    }
+
+    // drops one reference; deletes the GL texture with the last one and returns true then. Unknown textures are ignored
+    static bool release(unsigned int textureID)
+    {
+        Registry &registry = instance();
+        auto key = registry.keys.find(textureID);
+        if (key == registry.keys.end())
+            return false;
+        auto entry = registry.entries.find(key->second);
+        if (--entry->second.references > 0)
+            return false;
+
+        glDeleteTextures(1, &textureID);
+        GLState::forgetTexture(textureID);
+        registry.statistics.residentTextures--;
+        registry.statistics.residentBytes -= entry->second.bytes;
+        registry.entries.erase(entry);
+        registry.keys.erase(key);
+        return true;
+    }
+
+    static TextureRegistryStatistics statistics()
+    {
+        return instance().statistics;
+    }
+
+private:
+    struct Entry {
+        unsigned int textureID = 0;
+        unsigned int references = 0;
+        size_t bytes = 0;
+    };
+
+    struct Registry {
+        unordered_map<string, Entry> entries;
+        unordered_map<unsigned int, string> keys;
+        TextureRegistryStatistics statistics;
+    };
+
+    static Registry& instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+};
+#endif
@@ -0,0 +1,417 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/upload_queue.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+struct TextureStreamingStatistics {
+    size_t budgetBytes = 0;
+    size_t residentBytes = 0;  // mip levels currently on the GPU
+    size_t requestedBytes = 0; // what the textures drawn last frame would need at their requested resolution
+    unsigned int textures = 0;
+    unsigned int loadsInFlight = 0;
+    unsigned long long levelsLoaded = 0;
+    unsigned long long levelsEvicted = 0;
+
+    void print(std::ostream &out = std::cout) const
+    {
+        out << "TEXTURE_STREAMER:: " << textures << " textures, resident " << residentBytes / (1024 * 1024)
+            << " MiB / requested " << requestedBytes / (1024 * 1024) << " MiB / budget " << budgetBytes / (1024 * 1024)
+            << " MiB, " << loadsInFlight << " loads in flight, " << levelsLoaded << " levels loaded, "
+            << levelsEvicted << " evicted" << std::endl;
+    }
+};
+
+// a decoded image reduced to the mip levels a streamed texture starts with, built on a worker thread
+struct StreamingImage {
+    string path;
+    string directory;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    int firstLevel = 0;                  // mip level of levels[0]
+    bool srgb = false;                   // mips filtered in linear light
+    vector<vector<unsigned char>> levels; // firstLevel .. last level of the full chain
+};
+
+// streams the mip levels of model textures by on-screen demand within a VRAM budget.
+// a texture starts with only its small mips (those no larger than kResidentSize) on the GPU. Drawing code reports how many
+// screen pixels one UV unit covers (requestResolution); update() then reloads the file on a worker, builds the missing finer
+// levels and uploads them (through the upload queue when there is one), and moves GL_TEXTURE_BASE_LEVEL down once they are in.
+// when the budget would be exceeded, levels finer than requested and then the least recently used textures are evicted by
+// raising the base level and redefining the freed levels as empty. Texture names never change, so meshes keep their bindings.
+// everything but the workers' decode runs on the thread owning the GL context.
+class TextureStreamer
+{
+public:
+    static const int kResidentSize = 64;
+    size_t budgetBytes;
+
+    explicit TextureStreamer(size_t budgetBytes = 512 * 1024 * 1024, UploadQueue *uploads = nullptr)
+        : budgetBytes(budgetBytes), uploads(uploads)
+    {
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // worker-side part of creating a streamed texture: builds the mip chain and keeps the always-resident levels.
+    // streamed textures are kept uncompressed, so the image must come from decode() without the cooked cache
+    static StreamingImage prepare(DecodedImage image, const string &directory, bool srgb = false)
+    {
+        StreamingImage prepared;
+        prepared.path = image.path;
+        prepared.directory = directory;
+        prepared.srgb = srgb;
+        if (!image.data)
+            return prepared;
+        prepared.width = image.width;
+        prepared.height = image.height;
+        prepared.components = image.components;
+        prepared.firstLevel = firstResidentLevel(image.width, image.height);
+        prepared.levels = TextureLoader::buildMipLevels(image.data, image.width, image.height, image.components, prepared.firstLevel, srgb);
+        return prepared;
+    }
+
+    // creates the GL texture with only the prepared levels resident. Returns its name
+    unsigned int create(StreamingImage image)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (image.levels.empty())
+            return textureID;
+
+        Entry entry;
+        entry.path = std::move(image.path);
+        entry.directory = std::move(image.directory);
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.components = image.components;
+        entry.srgb = image.srgb;
+        entry.format = TextureLoader::pixelFormat(image.components);
+        entry.levelCount = levelCount(image.width, image.height);
+        entry.residentTop = image.firstLevel;
+        entry.minimumTop = image.firstLevel;
+        entry.requestedTop = image.firstLevel;
+
+        GLState::bindTextureForUpdate(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.residentTop);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levelCount - 1);
+        GLint alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < image.levels.size(); i++)
+        {
+            const int level = image.firstLevel + static_cast<int>(i);
+            glTexImage2D(GL_TEXTURE_2D, level, entry.format, levelSize(entry.width, level), levelSize(entry.height, level), 0, entry.format, GL_UNSIGNED_BYTE, image.levels[i].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+        residentBytes += levelBytes(entry, entry.residentTop, entry.levelCount);
+        textures[textureID] = std::move(entry);
+        return textureID;
+    }
+
+    // bytes a newly created texture occupies on the GPU
+    size_t residentSize(unsigned int textureID) const
+    {
+        auto texture = textures.find(textureID);
+        return texture == textures.end() ? 0 : levelBytes(texture->second, texture->second.residentTop, texture->second.levelCount);
+    }
+
+    // forget a texture whose GL name was deleted elsewhere. A load in progress is abandoned: its budget is given back,
+    // its queued uploads are dropped and the decode finishes on the worker into nothing
+    void remove(unsigned int textureID)
+    {
+        auto texture = textures.find(textureID);
+        if (texture == textures.end())
+            return;
+        if (texture->second.loading)
+            cancelLoad(texture->second);
+        if (uploads)
+            uploads->cancelTexture(textureID);
+        residentBytes -= levelBytes(texture->second, texture->second.residentTop, texture->second.levelCount);
+        textures.erase(texture);
+    }
+
+    // called while drawing: the texture is visible this frame with one UV unit spanning pixelsPerUv screen pixels.
+    // the finest level with at most one texel per pixel is requested; multiple requests in a frame keep the finest
+    void requestResolution(unsigned int textureID, float pixelsPerUv)
+    {
+        auto texture = textures.find(textureID);
+        if (texture == textures.end())
+            return;
+        Entry &entry = texture->second;
+        const float texels = static_cast<float>(std::max(entry.width, entry.height));
+        int top = pixelsPerUv > 0.0f ? static_cast<int>(std::floor(std::log2(texels / pixelsPerUv))) : entry.minimumTop;
+        top = std::min(std::max(top, 0), entry.minimumTop);
+        if (entry.lastUsedFrame != frame)
+        {
+            entry.lastUsedFrame = frame;
+            entry.requestedTop = top;
+        }
+        else
+            entry.requestedTop = std::min(entry.requestedTop, top);
+    }
+
+    // once per frame, after drawing: finishes arrived loads, evicts over budget and starts the most needed loads
+    void update()
+    {
+        finishLoads();
+
+        // serve the biggest resolution deficits first
+        vector<pair<int, unsigned int>> wanted;
+        statistics.requestedBytes = 0;
+        for (auto &texture : textures)
+        {
+            Entry &entry = texture.second;
+            if (entry.lastUsedFrame != frame)
+                continue;
+            statistics.requestedBytes += levelBytes(entry, entry.requestedTop, entry.levelCount);
+            if (entry.requestedTop < entry.residentTop && !entry.loading)
+                wanted.push_back(make_pair(entry.residentTop - entry.requestedTop, texture.first));
+        }
+        std::sort(wanted.begin(), wanted.end(), [](const pair<int, unsigned int> &a, const pair<int, unsigned int> &b) { return a.first > b.first; });
+
+        const unsigned int maxLoads = std::max(1u, ThreadPool::shared().size());
+        for (size_t i = 0; i < wanted.size() && loadsInFlight < maxLoads; i++)
+        {
+            // settle for the finest level that fits when the requested one doesn't
+            Entry &entry = textures[wanted[i].second];
+            for (int top = entry.requestedTop; top < entry.residentTop; top++)
+            {
+                if (makeRoom(levelBytes(entry, top, entry.residentTop), wanted[i].second))
+                {
+                    startLoad(entry, top);
+                    break;
+                }
+            }
+        }
+        // drop what nobody asked for when something else pushed us over budget meanwhile (e.g. a budget change)
+        makeRoom(0, 0);
+
+        statistics.budgetBytes = budgetBytes;
+        statistics.residentBytes = residentBytes;
+        statistics.textures = static_cast<unsigned int>(textures.size());
+        statistics.loadsInFlight = loadsInFlight;
+        frame++;
+    }
+
+    const TextureStreamingStatistics& getStatistics() const
+    {
+        return statistics;
+    }
+
+    // level sizes follow the GL rule: halve and round down, never below one texel
+    static int levelSize(int size, int level)
+    {
+        return std::max(1, size >> level);
+    }
+
+    static int levelCount(int width, int height)
+    {
+        int levels = 1;
+        while ((std::max(width, height) >> levels) > 0)
+            levels++;
+        return levels;
+    }
+
+    // the finest level that is small enough to keep resident at all times
+    static int firstResidentLevel(int width, int height)
+    {
+        int level = 0;
+        while (std::max(levelSize(width, level), levelSize(height, level)) > kResidentSize)
+            level++;
+        return level;
+    }
+
+private:
+    struct Entry {
+        string path;
+        string directory;
+        int width = 0, height = 0, components = 0;
+        bool srgb = false;
+        GLenum format = GL_RGBA;
+        int levelCount = 1;
+        int residentTop = 0;  // finest level on the GPU, the texture's base level
+        int minimumTop = 0;   // coarsest base level, the always-resident part starts here
+        int requestedTop = 0; // finest level the last frame that drew it asked for
+        unsigned long long lastUsedFrame = 0;
+        bool loading = false;
+        int loadingTop = 0;
+        future<StreamingImage> decode; // reload of the file with the finer levels, from the worker pool
+        unsigned long long uploadTicket = 0;
+        bool uploading = false;
+    };
+
+    UploadQueue *uploads;
+    unordered_map<unsigned int, Entry> textures;
+    size_t residentBytes = 0;
+    size_t loadingBytes = 0; // levels allocated or being decoded that aren't in residentBytes yet
+    unsigned int loadsInFlight = 0;
+    unsigned long long frame = 1;
+    TextureStreamingStatistics statistics;
+
+    static size_t levelBytes(const Entry &entry, int first, int end)
+    {
+        const size_t texelBytes = entry.components == 3 ? 4 : static_cast<size_t>(entry.components);
+        size_t bytes = 0;
+        for (int level = first; level < end; level++)
+            bytes += static_cast<size_t>(levelSize(entry.width, level)) * levelSize(entry.height, level) * texelBytes;
+        return bytes;
+    }
+
+    void startLoad(Entry &entry, int top)
+    {
+        entry.loading = true;
+        entry.loadingTop = top;
+        loadingBytes += levelBytes(entry, top, entry.residentTop);
+        loadsInFlight++;
+        const string path = entry.path, directory = entry.directory;
+        const int end = entry.residentTop;
+        const bool srgb = entry.srgb;
+        entry.decode = ThreadPool::shared().submit([path, directory, top, end, srgb] {
+            StreamingImage image;
+            DecodedImage decoded = TextureLoader::decode(path, directory, false);
+            if (!decoded.data)
+                return image;
+            image.width = decoded.width;
+            image.height = decoded.height;
+            image.components = decoded.components;
+            image.firstLevel = top;
+            image.levels = TextureLoader::buildMipLevels(decoded.data, decoded.width, decoded.height, decoded.components, top, srgb);
+            image.levels.resize(end - top); // only the levels that aren't resident yet
+            return image;
+        });
+    }
+
+    void finishLoads()
+    {
+        for (auto &texture : textures)
+        {
+            Entry &entry = texture.second;
+            if (!entry.loading)
+                continue;
+            if (!entry.uploading)
+            {
+                if (entry.decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    continue;
+                StreamingImage image = entry.decode.get();
+                if (image.levels.empty() || image.width != entry.width || image.height != entry.height || image.components != entry.components)
+                {
+                    std::cout << "ERROR::TEXTURE_STREAMER::RELOAD_FAILED " << entry.path << std::endl;
+                    cancelLoad(entry);
+                    entry.minimumTop = entry.residentTop; // don't retry
+                    continue;
+                }
+                uploadLevels(texture.first, entry, std::move(image));
+            }
+            if (entry.uploading && uploads && !uploads->isComplete(entry.uploadTicket))
+                continue;
+
+            // the new levels are all in: sample from them
+            GLState::bindTextureForUpdate(GL_TEXTURE_2D, texture.first);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.loadingTop);
+            const size_t bytes = levelBytes(entry, entry.loadingTop, entry.residentTop);
+            statistics.levelsLoaded += entry.residentTop - entry.loadingTop;
+            residentBytes += bytes;
+            loadingBytes -= bytes;
+            entry.residentTop = entry.loadingTop;
+            entry.loading = entry.uploading = false;
+            loadsInFlight--;
+        }
+    }
+
+    void uploadLevels(unsigned int textureID, Entry &entry, StreamingImage image)
+    {
+        GLState::bindTextureForUpdate(GL_TEXTURE_2D, textureID);
+        GLint alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        auto owner = make_shared<StreamingImage>(std::move(image));
+        for (size_t i = 0; i < owner->levels.size(); i++)
+        {
+            const int level = owner->firstLevel + static_cast<int>(i);
+            const int w = levelSize(entry.width, level), h = levelSize(entry.height, level);
+            if (uploads)
+            {
+                glTexImage2D(GL_TEXTURE_2D, level, entry.format, w, h, 0, entry.format, GL_UNSIGNED_BYTE, nullptr);
+                entry.uploadTicket = uploads->enqueueTexture(textureID, level, w, h, entry.format, entry.components, false, owner->levels[i].data(), owner);
+            }
+            else
+                glTexImage2D(GL_TEXTURE_2D, level, entry.format, w, h, 0, entry.format, GL_UNSIGNED_BYTE, owner->levels[i].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+        entry.uploading = true;
+    }
+
+    void cancelLoad(Entry &entry)
+    {
+        loadingBytes -= levelBytes(entry, entry.loadingTop, entry.residentTop);
+        entry.loading = entry.uploading = false;
+        loadsInFlight--;
+    }
+
+    // evicts until `needed` more bytes fit the budget. Unneeded detail goes first, then least recently used textures;
+    // `keep` and anything drawn this frame at its requested level are never touched. Returns whether it fits
+    bool makeRoom(size_t needed, unsigned int keep)
+    {
+        while (residentBytes + loadingBytes + needed > budgetBytes)
+        {
+            unsigned int victim = 0;
+            bool victimUnneeded = false;
+            unsigned long long victimFrame = 0;
+            for (auto &texture : textures)
+            {
+                const Entry &entry = texture.second;
+                if (texture.first == keep || entry.loading || entry.residentTop >= entry.minimumTop)
+                    continue;
+                const bool unneeded = entry.residentTop < entry.requestedTop;
+                if (!unneeded && entry.lastUsedFrame == frame)
+                    continue;
+                if (victim == 0 || (unneeded && !victimUnneeded) || (unneeded == victimUnneeded && entry.lastUsedFrame < victimFrame))
+                {
+                    victim = texture.first;
+                    victimUnneeded = unneeded;
+                    victimFrame = entry.lastUsedFrame;
+                }
+            }
+            if (victim == 0)
+                return false;
+            evictTopLevel(victim, textures[victim]);
+        }
+        return true;
+    }
+
+    void evictTopLevel(unsigned int textureID, Entry &entry)
+    {
+        const int level = entry.residentTop;
+        GLState::bindTextureForUpdate(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+        // an empty image releases the level's storage; the texture stays complete from the new base level
+        glTexImage2D(GL_TEXTURE_2D, level, entry.format, 0, 0, 0, entry.format, GL_UNSIGNED_BYTE, nullptr);
+        residentBytes -= levelBytes(entry, level, level + 1);
+        entry.residentTop = level + 1;
+        statistics.levelsEvicted++;
+    }
+};
+#endif
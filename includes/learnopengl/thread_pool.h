@@ -0,0 +1,134 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fixed-size worker pool for CPU-side loading work (image decoding, mesh processing).
+// jobs must not touch OpenGL: the context is only current on the thread that created it.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // process-wide pool sized to the number of hardware threads
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    unsigned int size() const
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    // queues a job and returns a future for its result
+    template <typename F>
+    auto submit(F&& job) -> std::future<typename std::invoke_result<F>::type>
+    {
+        using Result = typename std::invoke_result<F>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.emplace_back([task] { (*task)(); });
+        }
+        wakeup.notify_one();
+        return result;
+    }
+
+    // runs job(i) for i in [0, count) across the pool and the calling thread, returning once all are done.
+    // may be called from inside a pool job: the caller waits for the indices rather than for its helpers, so helpers
+    // still queued behind busy workers are not needed and find nothing left to do when they finally run
+    template <typename F>
+    void parallelFor(size_t count, F&& job)
+    {
+        if (count == 0)
+            return;
+        struct Progress {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            size_t count = 0;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto progress = std::make_shared<Progress>();
+        progress->count = count;
+        auto *body = &job;
+        auto worker = [progress, body] {
+            for (size_t i = progress->next++; i < progress->count; i = progress->next++)
+            {
+                (*body)(i);
+                if (++progress->done == progress->count)
+                {
+                    std::lock_guard<std::mutex> lock(progress->mutex);
+                    progress->finished.notify_all();
+                }
+            }
+        };
+        size_t helpers = std::min<size_t>(workers.size(), count - 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < helpers; i++)
+                jobs.emplace_back(worker);
+        }
+        if (helpers > 0)
+            wakeup.notify_all();
+        worker();
+        std::unique_lock<std::mutex> lock(progress->mutex);
+        progress->finished.wait(lock, [&] { return progress->done == progress->count; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+#endif
@@ -0,0 +1,299 @@
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 32-bit FNV-1a hash of a uniform name, which is what the shader setters look locations up by.
+// constexpr, so a literal is hashed at compile time where that is required, e.g. static constexpr UniformId kModel("model"),
+// and by the optimizer in a plain setMat4("model", ...) call. Array elements and numbered names are hashed on from
+// their base instead of formatting a string: UniformId("finalBonesMatrices")[i], UniformId("texture_diffuse").withNumber(1)
+struct UniformId {
+    uint32_t hash = kOffsetBasis;
+
+    constexpr UniformId() = default;
+
+    constexpr UniformId(const char *name)
+    {
+        while (*name)
+            hash = add(hash, *name++);
+    }
+
+    UniformId(const std::string &name)
+    {
+        for (char c : name)
+            hash = add(hash, c);
+    }
+
+    // name[index]
+    constexpr UniformId operator[](unsigned int index) const
+    {
+        return fromHash(add(addNumber(add(hash, '['), index), ']'));
+    }
+
+    // name with number appended in decimal, the N of texture_diffuseN
+    constexpr UniformId withNumber(unsigned int number) const
+    {
+        return fromHash(addNumber(hash, number));
+    }
+
+    constexpr bool operator==(const UniformId &other) const
+    {
+        return hash == other.hash;
+    }
+
+    constexpr bool operator!=(const UniformId &other) const
+    {
+        return hash != other.hash;
+    }
+
+private:
+    static constexpr uint32_t kOffsetBasis = 2166136261u;
+    static constexpr uint32_t kPrime = 16777619u;
+
+    static constexpr uint32_t add(uint32_t h, char c)
+    {
+        return (h ^ static_cast<uint8_t>(c)) * kPrime;
+    }
+
+    static constexpr uint32_t addNumber(uint32_t h, unsigned int number)
+    {
+        unsigned int divisor = 1;
+        while (number / divisor >= 10)
+            divisor *= 10;
+        for (; divisor > 0; divisor /= 10)
+            h = add(h, static_cast<char>('0' + number / divisor % 10));
+        return h;
+    }
+
+    static constexpr UniformId fromHash(uint32_t h)
+    {
+        UniformId id;
+        id.hash = h;
+        return id;
+    }
+};
+
+static_assert(UniformId("lights")[12] == UniformId("lights[12]"), "array element ids must match the element's name");
+static_assert(UniformId("texture_diffuse").withNumber(1) == UniformId("texture_diffuse1"), "numbered ids must match the numbered name");
+
+// an active uniform of a linked program, as glGetActiveUniform reports it
+struct UniformInfo {
+    std::string name; // arrays end in [0]
+    GLenum type;
+    GLint size;       // array length, 1 otherwise
+    GLint location;
+};
+
+// glUniform* calls made and skipped by the setters of all shaders
+struct UniformStatistics {
+    unsigned long long issued = 0;
+    unsigned long long skipped = 0; // the value was already set
+};
+
+// locations of every active uniform of a program, read once after linking and kept as a flat table sorted by name
+// hash. Arrays can be found by their base name (element 0) and by every element, like glGetUniformLocation allows.
+// lookups are a binary search over the hashes, with no string work and no call into the driver; names the program
+// doesn't use (optimized out, misspelled) give -1, which glUniform* ignores.
+// the table also shadows the value last set at each location, so that setting what a uniform already holds doesn't
+// reach the driver. That holds as long as every update goes through the setters while the program is in use; call
+// invalidate() after setting uniforms of the program any other way. Copies share the table and its shadow values
+class UniformTable
+{
+public:
+    void build(GLuint program)
+    {
+        state = std::make_shared<State>();
+        if (program == 0)
+            return; // failed to build, nothing to look up
+        for (const auto &block : blockBindings())
+        {
+            GLuint index = glGetUniformBlockIndex(program, block.first.c_str());
+            if (index != GL_INVALID_INDEX)
+                glUniformBlockBinding(program, index, block.second);
+        }
+        std::vector<Entry> &entries = state->entries;
+        std::vector<UniformInfo> &uniforms = state->uniforms;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            UniformInfo info;
+            glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &info.size, &info.type, buffer.data());
+            info.name.assign(buffer.data(), length);
+            info.location = glGetUniformLocation(program, info.name.c_str());
+            if (info.location < 0)
+                continue; // members of uniform blocks and built-ins have no location
+            uniforms.push_back(info);
+
+            const bool array = info.name.size() > 3 && info.name.compare(info.name.size() - 3, 3, "[0]") == 0;
+            if (!array)
+            {
+                add(UniformId(info.name), info.location);
+                continue;
+            }
+            const std::string base = info.name.substr(0, info.name.size() - 3);
+            add(UniformId(base), info.location);
+            for (GLint element = 0; element < info.size; element++)
+                add(UniformId(base)[element], element == 0 ? info.location : glGetUniformLocation(program, (base + '[' + std::to_string(element) + ']').c_str()));
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.hash < b.hash; });
+        for (size_t i = 1; i < entries.size(); i++)
+            if (entries[i].hash == entries[i - 1].hash && entries[i].location != entries[i - 1].location)
+                std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION at locations " << entries[i - 1].location << " and " << entries[i].location << std::endl;
+
+        // one shadow value per location; an array's base name and its element 0 share theirs
+        std::map<GLint, uint32_t> slots;
+        for (Entry &entry : entries)
+            entry.slot = slots.emplace(entry.location, static_cast<uint32_t>(slots.size())).first->second;
+        state->values.resize(slots.size());
+    }
+
+    GLint location(UniformId id) const
+    {
+        const Entry *entry = find(id);
+        return entry ? entry->location : -1;
+    }
+
+    // the location to upload value to, or -1 when the uniform already holds these bytes (set with the same kind of
+    // glUniform call, type) or doesn't exist. Records value as the uniform's new one
+    GLint changed(UniformId id, GLenum type, const void *value, size_t bytes) const
+    {
+        const Entry *entry = find(id);
+        return entry && changed(static_cast<int>(entry->slot), type, value, bytes) ? entry->location : -1;
+    }
+
+    // the index of a uniform's shadow value, for callers that look uniforms up once and keep their locations next to
+    // it (ProgramBindings); -1 when the program has no such active uniform
+    int slot(UniformId id) const
+    {
+        const Entry *entry = find(id);
+        return entry ? static_cast<int>(entry->slot) : -1;
+    }
+
+    // whether value has to be uploaded to the uniform of slot, like changed() above, and records it as the new one.
+    // values hold at most a mat4
+    bool changed(int slot, GLenum type, const void *value, size_t bytes) const
+    {
+        if (slot < 0)
+            return false;
+        Value &shadow = state->values[slot];
+        if (shadow.type == type && std::memcmp(shadow.bytes, value, bytes) == 0)
+        {
+            frameStatistics.skipped++;
+            return false;
+        }
+        shadow.type = type;
+        std::memcpy(shadow.bytes, value, bytes);
+        frameStatistics.issued++;
+        return true;
+    }
+
+    // counts one upload made without comparing, such as of a whole array, and forgets the shadow values of the count
+    // slots it overwrote
+    void issued(const int *slots, size_t count) const
+    {
+        frameStatistics.issued++;
+        for (size_t i = 0; i < count; i++)
+            if (slots[i] >= 0)
+                state->values[slots[i]].type = GL_NONE;
+    }
+
+    // forgets the shadow values, so the next set of every uniform reaches the driver
+    void invalidate()
+    {
+        if (state)
+            for (Value &value : state->values)
+                value.type = GL_NONE;
+    }
+
+    const std::vector<UniformInfo>& activeUniforms() const
+    {
+        static const std::vector<UniformInfo> none;
+        return state ? state->uniforms : none;
+    }
+
+    // binds the uniform block called name to binding in every program built from now on, for blocks shared by all
+    // programs such as FrameConstants. GLSL 330 has no layout(binding = N), so it is done here after linking
+    static void setBlockBinding(const std::string &name, GLuint binding)
+    {
+        for (auto &block : blockBindings())
+            if (block.first == name)
+            {
+                block.second = binding;
+                return;
+            }
+        blockBindings().emplace_back(name, binding);
+    }
+
+    // counts of the last finished frame, see endFrame()
+    static UniformStatistics getStatistics()
+    {
+        return lastFrameStatistics;
+    }
+
+    // call once per frame: closes the frame's counts for getStatistics() and starts counting the next one
+    static void endFrame()
+    {
+        lastFrameStatistics = frameStatistics;
+        frameStatistics = UniformStatistics();
+    }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        GLint location;
+        uint32_t slot;
+    };
+
+    struct Value {
+        GLenum type = GL_NONE; // GL_NONE until set through the table
+        unsigned char bytes[16 * sizeof(float)];
+    };
+
+    struct State {
+        std::vector<Entry> entries;
+        std::vector<UniformInfo> uniforms;
+        std::vector<Value> values;
+    };
+
+    std::shared_ptr<State> state;
+
+    static inline UniformStatistics frameStatistics;
+    static inline UniformStatistics lastFrameStatistics;
+
+    static std::vector<std::pair<std::string, GLuint>>& blockBindings()
+    {
+        static std::vector<std::pair<std::string, GLuint>> bindings;
+        return bindings;
+    }
+
+    const Entry* find(UniformId id) const
+    {
+        if (!state)
+            return nullptr;
+        const std::vector<Entry> &entries = state->entries;
+        auto it = std::lower_bound(entries.begin(), entries.end(), id.hash, [](const Entry &entry, uint32_t hash) { return entry.hash < hash; });
+        return it != entries.end() && it->hash == id.hash ? &*it : nullptr;
+    }
+
+    void add(UniformId id, GLint location)
+    {
+        if (location >= 0)
+            state->entries.push_back(Entry{id.hash, location, 0});
+    }
+};
+#endif
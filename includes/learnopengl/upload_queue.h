@@ -0,0 +1,382 @@
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <vector>
+using namespace std;
+
+struct UploadQueueStatistics {
+    size_t bytesThisFrame = 0;
+    double millisecondsThisFrame = 0.0;
+    size_t pendingBytes = 0;
+    size_t pendingRequests = 0;
+    unsigned long long ringFullStalls = 0; // frames that stopped early because the GPU hadn't consumed the ring yet
+};
+
+// streams texture and buffer data to the GPU a slice at a time instead of in one blocking call.
+// data is copied into a persistently mapped staging ring (a plain buffer written with glBufferSubData where
+// GL 4.4 is missing), and copied on the GPU into its destination from there: glTexSubImage2D from the ring bound
+// as GL_PIXEL_UNPACK_BUFFER, glCopyBufferSubData for buffers. process() is called once per frame and stops at the
+// frame's byte or time budget; a fence after each frame's slices tells when that part of the ring can be reused.
+// requests finish in the order they were queued, so a single ticket number tells whether one has completed.
+// everything here runs on the thread owning the GL context.
+class UploadQueue
+{
+public:
+    size_t frameByteBudget;
+    double frameTimeBudgetMs;
+
+    UploadQueue(size_t ringBytes = 64 * 1024 * 1024, size_t frameByteBudget = 8 * 1024 * 1024, double frameTimeBudgetMs = 2.0)
+        : frameByteBudget(frameByteBudget), frameTimeBudgetMs(frameTimeBudgetMs), capacity(ringBytes)
+    {
+        glGenBuffers(1, &ring);
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+        if (glBufferStorage)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, flags);
+            mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity, flags));
+        }
+        else
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    ~UploadQueue()
+    {
+        for (const Batch &batch : inFlight)
+            glDeleteSync(batch.fence);
+        if (mapped)
+        {
+            GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &ring);
+        GLState::forgetBuffer(ring);
+    }
+
+    UploadQueue(const UploadQueue&) = delete;
+    UploadQueue& operator=(const UploadQueue&) = delete;
+
+    // queues size bytes of data for buffer[offset, offset + size). owner keeps data alive until it has been staged.
+    // returns the ticket to pass to isComplete()
+    unsigned long long enqueueBuffer(GLuint buffer, size_t offset, const void *data, size_t size, shared_ptr<const void> owner)
+    {
+        Request request;
+        request.buffer = buffer;
+        request.offset = offset;
+        request.data = static_cast<const unsigned char*>(data);
+        request.size = size;
+        request.owner = std::move(owner);
+        return push(std::move(request));
+    }
+
+    // takes the vector over until it has been staged
+    template <typename T>
+    unsigned long long enqueueBuffer(GLuint buffer, size_t offset, vector<T> data)
+    {
+        auto owner = make_shared<vector<T>>(std::move(data));
+        return enqueueBuffer(buffer, offset, owner->data(), owner->size() * sizeof(T), owner);
+    }
+
+    // queues one level of a 2D texture whose storage already exists. Rows are tightly packed (any row length works).
+    // with generateMipmap the levels below it are built on the GPU once the last row is in
+    unsigned long long enqueueTexture(GLuint texture, int level, int width, int height, GLenum format, int bytesPerPixel, bool generateMipmap, const void *data, shared_ptr<const void> owner)
+    {
+        Request request;
+        request.texture = texture;
+        request.level = level;
+        request.width = width;
+        request.height = height;
+        request.format = format;
+        request.rowBytes = static_cast<size_t>(width) * bytesPerPixel;
+        request.generateMipmap = generateMipmap;
+        request.data = static_cast<const unsigned char*>(data);
+        request.size = request.rowBytes * height;
+        request.owner = std::move(owner);
+        return push(std::move(request));
+    }
+
+    // queues one level of a block compressed 2D texture whose storage already exists; sliced in rows of 4x4 blocks
+    unsigned long long enqueueCompressedTexture(GLuint texture, int level, int width, int height, GLenum format, int blockBytes, const void *data, shared_ptr<const void> owner)
+    {
+        Request request;
+        request.texture = texture;
+        request.level = level;
+        request.width = width;
+        request.height = height;
+        request.format = format;
+        request.compressed = true;
+        request.rowBytes = static_cast<size_t>((width + 3) / 4) * blockBytes;
+        request.data = static_cast<const unsigned char*>(data);
+        request.size = request.rowBytes * ((height + 3) / 4);
+        request.owner = std::move(owner);
+        return push(std::move(request));
+    }
+
+    // drops whatever of texture's uploads hasn't been issued yet; call when deleting a texture whose uploads may still
+    // be queued, before the next process(). Slices already issued were issued while the texture existed. Returns the
+    // number of requests dropped; their tickets complete along with the requests queued after them
+    size_t cancelTexture(GLuint texture)
+    {
+        size_t dropped = 0;
+        for (auto request = pending.begin(); request != pending.end();)
+        {
+            if (request->texture != texture)
+            {
+                ++request;
+                continue;
+            }
+            statistics.pendingBytes -= request->size - request->done;
+            statistics.pendingRequests--;
+            request = pending.erase(request);
+            dropped++;
+        }
+        return dropped;
+    }
+
+    bool isComplete(unsigned long long ticket) const
+    {
+        return ticket <= completedTicket;
+    }
+
+    bool empty() const
+    {
+        return pending.empty() && inFlight.empty();
+    }
+
+    // retires the slices the GPU has finished with, then issues new ones until the frame's budget is spent.
+    // call once per frame
+    void process()
+    {
+        process(frameByteBudget, frameTimeBudgetMs);
+    }
+
+    void process(size_t byteBudget, double timeBudgetMs)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        retire(false);
+
+        size_t issued = 0;
+        unsigned long long lastFinished = 0;
+        while (!pending.empty() && issued < byteBudget)
+        {
+            if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= timeBudgetMs)
+                break;
+
+            Request &request = pending.front();
+            size_t slice = std::min(std::min(request.size - request.done, byteBudget - issued), capacity / 2);
+            if (request.texture != 0) // whole rows only
+                slice = std::max<size_t>(slice / request.rowBytes, 1) * request.rowBytes;
+
+            size_t ringOffset;
+            if (!allocate(slice, ringOffset))
+            {
+                // the GPU still reads the space we need, pick up here next frame
+                statistics.ringFullStalls++;
+                break;
+            }
+            stage(request, ringOffset, slice);
+            issued += slice;
+            request.done += slice;
+            statistics.pendingBytes -= slice;
+            if (request.done == request.size)
+            {
+                if (request.texture != 0 && request.generateMipmap)
+                {
+                    GLState::bindTextureForUpdate(GL_TEXTURE_2D, request.texture);
+                    glGenerateMipmap(GL_TEXTURE_2D);
+                }
+                lastFinished = request.ticket;
+                pending.pop_front(); // releases the owner, the data lives in the ring now
+                statistics.pendingRequests--;
+            }
+        }
+
+        if (issued > 0)
+        {
+            Batch batch;
+            batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            batch.ringEnd = head;
+            batch.bytes = batchBytes;
+            batch.lastTicket = lastFinished;
+            inFlight.push_back(batch);
+            batchBytes = 0;
+        }
+        statistics.bytesThisFrame = issued;
+        statistics.millisecondsThisFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // uploads everything that is queued and waits for the GPU to finish it, for loading screens and shutdown
+    void finish()
+    {
+        while (!pending.empty())
+        {
+            process(capacity, 1e30);
+            if (!pending.empty())
+                retire(true);
+        }
+        retire(true);
+    }
+
+    const UploadQueueStatistics& getStatistics() const
+    {
+        return statistics;
+    }
+
+private:
+    static const size_t kAlignment = 16;
+
+    struct Request {
+        unsigned long long ticket = 0;
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+        size_t done = 0;
+        shared_ptr<const void> owner;
+        // buffer destination
+        GLuint buffer = 0;
+        size_t offset = 0;
+        // texture destination
+        GLuint texture = 0;
+        int level = 0;
+        int width = 0, height = 0;
+        GLenum format = GL_RGBA;
+        bool compressed = false; // format is a block format and a "row" is a row of 4x4 blocks
+        size_t rowBytes = 0;
+        bool generateMipmap = false;
+    };
+
+    struct Batch {
+        GLsync fence = 0;
+        size_t ringEnd = 0;
+        size_t bytes = 0;
+        unsigned long long lastTicket = 0; // newest request fully issued in this batch, 0 if none
+    };
+
+    GLuint ring = 0;
+    unsigned char *mapped = nullptr;
+    size_t capacity;
+    // staging ring: [tail, head) is written but maybe not consumed yet, used counts it including skipped wrap space
+    size_t head = 0, tail = 0, used = 0, batchBytes = 0;
+    deque<Request> pending;
+    deque<Batch> inFlight;
+    unsigned long long nextTicket = 1, completedTicket = 0;
+    UploadQueueStatistics statistics;
+
+    unsigned long long push(Request request)
+    {
+        if (request.size == 0)
+            return 0; // nothing to wait for, isComplete(0) is always true
+        request.ticket = nextTicket++;
+        statistics.pendingBytes += request.size;
+        statistics.pendingRequests++;
+        pending.push_back(std::move(request));
+        return pending.back().ticket;
+    }
+
+    // reserves size bytes of contiguous ring space
+    bool allocate(size_t size, size_t &offset)
+    {
+        size = (size + kAlignment - 1) / kAlignment * kAlignment;
+        if (used == 0)
+            head = tail = 0;
+        if (used == capacity)
+            return false;
+
+        if (head >= tail)
+        {
+            if (capacity - head >= size)
+                offset = head;
+            else if (tail >= size)
+            {
+                // wrap, the end of the ring stays unused until this batch retires
+                used += capacity - head;
+                batchBytes += capacity - head;
+                offset = 0;
+            }
+            else
+                return false;
+        }
+        else if (tail - head >= size)
+            offset = head;
+        else
+            return false;
+
+        head = offset + size;
+        used += size;
+        batchBytes += size;
+        return true;
+    }
+
+    void stage(const Request &request, size_t ringOffset, size_t slice)
+    {
+        const unsigned char *source = request.data + request.done;
+        if (mapped)
+            memcpy(mapped + ringOffset, source, slice);
+
+        if (request.texture != 0)
+        {
+            GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+            if (!mapped)
+                glBufferSubData(GL_PIXEL_UNPACK_BUFFER, ringOffset, slice, source);
+            GLint alignment;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            GLState::bindTextureForUpdate(GL_TEXTURE_2D, request.texture);
+            const int firstRow = static_cast<int>(request.done / request.rowBytes);
+            const int rows = static_cast<int>(slice / request.rowBytes);
+            if (request.compressed)
+            {
+                const int y = firstRow * 4;
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, request.level, 0, y, request.width, std::min(rows * 4, request.height - y), request.format, static_cast<GLsizei>(slice), (void*)ringOffset);
+            }
+            else
+                glTexSubImage2D(GL_TEXTURE_2D, request.level, 0, firstRow, request.width, rows, request.format, GL_UNSIGNED_BYTE, (void*)ringOffset);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+            GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else
+        {
+            GLState::bindBuffer(GL_COPY_READ_BUFFER, ring);
+            if (!mapped)
+                glBufferSubData(GL_COPY_READ_BUFFER, ringOffset, slice, source);
+            GLState::bindBuffer(GL_COPY_WRITE_BUFFER, request.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, ringOffset, request.offset + request.done, slice);
+        }
+    }
+
+    // frees the ring space of every batch the GPU is done with; with wait, blocks until all of them are
+    void retire(bool wait)
+    {
+        while (!inFlight.empty())
+        {
+            Batch &batch = inFlight.front();
+            const GLenum status = glClientWaitSync(batch.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            {
+                if (status == GL_WAIT_FAILED)
+                    std::cout << "ERROR::UPLOAD_QUEUE::FENCE_WAIT_FAILED" << std::endl;
+                if (!wait || status == GL_WAIT_FAILED)
+                    return;
+                continue;
+            }
+            glDeleteSync(batch.fence);
+            tail = batch.ringEnd;
+            used -= batch.bytes;
+            if (batch.lastTicket != 0)
+                completedTicket = batch.lastTicket;
+            inFlight.pop_front();
+        }
+    }
+};
+#endif
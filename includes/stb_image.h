@@ -430,6 +430,23 @@ extern "C" {
     STBIDEF stbi_uc *stbi_load_from_memory(stbi_uc           const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels);
     STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *channels_in_file, int desired_channels);
 
+    // runs job(job_data, i) for every i in [0, count), in any order and on any threads, returning when all are done
+    typedef void stbi_parallel_for(void *context, int count, void(*job)(void *job_data, int index), void *job_data);
+
+    // like stbi_load_from_memory, but a baseline JPEG with restart markers is decoded in parallel through parallel_for:
+    // the restart intervals entropy decode concurrently and the rows are color converted in bands. Output is identical;
+    // files without restart markers and all other formats decode serially
+    STBIDEF stbi_uc *stbi_load_from_memory_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels,
+                                                    stbi_parallel_for *parallel_for, void *context);
+
+    // like stbi_load_from_memory_parallel (parallel_for may be NULL), but the pixels go to out, memory the caller owns such
+    // as a mapped pixel buffer or a pooled staging block, instead of a buffer stb_image allocates. out_size must hold
+    // x * y * channels bytes; stbi_info_from_memory tells how many that is beforehand. JPEGs and 8-bit PNGs that need no
+    // channel conversion are decoded right into out; other images decode as usual and are copied there. Returns 1 on
+    // success; on failure the contents of out are undefined
+    STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels,
+                                           stbi_uc *out, size_t out_size, stbi_parallel_for *parallel_for, void *context);
+
 #ifndef STBI_NO_STDIO
     STBIDEF stbi_uc *stbi_load_from_file(FILE *f, int *x, int *y, int *channels_in_file, int desired_channels);
     // for stbi_load_from_file, file pointer is left pointing immediately after image
@@ -510,6 +527,11 @@ extern "C" {
     // flip the image vertically, so the first pixel in the output array is the bottom left
     STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+    // use the SIMD and wide-word decode paths where they are compiled in; the default. These are the SSE2/NEON JPEG
+    // kernels (IDCT, YCbCr to RGB, 2x2 upsampling), SSE2 PNG unfiltering and word-at-a-time inflate. Turning them off
+    // selects the plain byte-wise code, e.g. to measure the speedup. Applies to decodes started afterwards
+    STBIDEF void stbi_set_simd(int flag_true_if_should_use_simd);
+
     // ZLIB client - used by PNG, available for other purposes
 
     STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -768,6 +790,9 @@ typedef struct
 
     stbi_uc *img_buffer, *img_buffer_end;
     stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+    stbi_uc *out_buffer; // caller's memory for the final image (stbi_load_from_memory_into), or NULL
+    size_t out_buffer_size;
 } stbi__context;
 
 
@@ -780,6 +805,8 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
     s->read_from_callbacks = 0;
     s->img_buffer = s->img_buffer_original = (stbi_uc *)buffer;
     s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *)buffer + len;
+    s->out_buffer = NULL;
+    s->out_buffer_size = 0;
 }
 
 // initialize a callback-based context
@@ -792,6 +819,8 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
     s->img_buffer_original = s->buffer_start;
     stbi__refill_buffer(s);
     s->img_buffer_original_end = s->img_buffer_end;
+    s->out_buffer = NULL;
+    s->out_buffer_size = 0;
 }
 
 #ifndef STBI_NO_STDIO
@@ -852,6 +881,8 @@ typedef struct
 #ifndef STBI_NO_JPEG
 static int      stbi__jpeg_test(stbi__context *s);
 static void    *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri);
+static stbi_uc *stbi__jpeg_load_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, stbi_parallel_for *parallel_for, void *context,
+                                         stbi_uc *out, size_t out_size, int *fallback);
 static int      stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp);
 #endif
 
@@ -993,6 +1024,19 @@ static void *stbi__malloc_mad4(int a, int b, int c, int d, int add)
     return stbi__malloc(a*b*c*d + add);
 }
 
+// the caller's buffer (stbi_load_from_memory_into) when there is one and the a*b*c byte final image fits, else NULL
+static stbi_uc *stbi__out_buffer_mad3(stbi__context *s, int a, int b, int c)
+{
+    if (!s->out_buffer || !stbi__mad3sizes_valid(a, b, c, 0) || (size_t)(a*b*c) > s->out_buffer_size) return NULL;
+    return s->out_buffer;
+}
+
+// frees a decoder's output buffer unless it is the caller's
+static void stbi__free_output(stbi__context *s, void *p)
+{
+    if (p != s->out_buffer) STBI_FREE(p);
+}
+
 // stbi__err - error
 // stbi__errpf - error returning pointer to float
 // stbi__errpuc - error returning pointer to unsigned char
@@ -1028,6 +1072,13 @@ STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip)
     stbi__vertically_flip_on_load = flag_true_if_should_flip;
 }
 
+static int stbi__simd = 1;
+
+STBIDEF void stbi_set_simd(int flag_true_if_should_use_simd)
+{
+    stbi__simd = flag_true_if_should_use_simd;
+}
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
     memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1105,6 +1156,22 @@ static stbi__uint16 *stbi__convert_8_to_16(stbi_uc *orig, int w, int h, int chan
     return enlarged;
 }
 
+static void stbi__vertical_flip_8bit(stbi_uc *image, int w, int h, int channels)
+{
+    int row, col, z;
+
+    // @OPTIMIZE: use a bigger temp buffer and memcpy multiple pixels at once
+    for (row = 0; row < (h >> 1); row++) {
+        for (col = 0; col < w; col++) {
+            for (z = 0; z < channels; z++) {
+                stbi_uc temp = image[(row * w + col) * channels + z];
+                image[(row * w + col) * channels + z] = image[((h - row - 1) * w + col) * channels + z];
+                image[((h - row - 1) * w + col) * channels + z] = temp;
+            }
+        }
+    }
+}
+
 static unsigned char *stbi__load_and_postprocess_8bit(stbi__context *s, int *x, int *y, int *comp, int req_comp)
 {
     stbi__result_info ri;
@@ -1121,23 +1188,8 @@ static unsigned char *stbi__load_and_postprocess_8bit(stbi__context *s, int *x,
 
     // @TODO: move stbi__convert_format to here
 
-    if (stbi__vertically_flip_on_load) {
-        int w = *x, h = *y;
-        int channels = req_comp ? req_comp : *comp;
-        int row, col, z;
-        stbi_uc *image = (stbi_uc *)result;
-
-        // @OPTIMIZE: use a bigger temp buffer and memcpy multiple pixels at once
-        for (row = 0; row < (h >> 1); row++) {
-            for (col = 0; col < w; col++) {
-                for (z = 0; z < channels; z++) {
-                    stbi_uc temp = image[(row * w + col) * channels + z];
-                    image[(row * w + col) * channels + z] = image[((h - row - 1) * w + col) * channels + z];
-                    image[((h - row - 1) * w + col) * channels + z] = temp;
-                }
-            }
-        }
-    }
+    if (stbi__vertically_flip_on_load)
+        stbi__vertical_flip_8bit((stbi_uc *)result, *x, *y, req_comp ? req_comp : *comp);
 
     return (unsigned char *)result;
 }
@@ -1281,6 +1333,55 @@ STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *u
     return stbi__load_and_postprocess_8bit(&s, x, y, comp, req_comp);
 }
 
+static stbi_uc *stbi__load_from_memory_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp,
+                                                stbi_parallel_for *parallel_for, void *context, stbi_uc *out, size_t out_size)
+{
+    stbi__context s;
+#ifndef STBI_NO_JPEG
+    if (parallel_for) {
+        int fallback, file_comp;
+        stbi_uc *result = stbi__jpeg_load_parallel(buffer, len, x, y, &file_comp, req_comp, parallel_for, context, out, out_size, &fallback);
+        if (!fallback) {
+            if (comp) *comp = file_comp;
+            if (stbi__vertically_flip_on_load)
+                stbi__vertical_flip_8bit(result, *x, *y, req_comp ? req_comp : file_comp);
+            return result;
+        }
+    }
+#endif
+    stbi__start_mem(&s, buffer, len);
+    s.out_buffer = out;
+    s.out_buffer_size = out_size;
+    return stbi__load_and_postprocess_8bit(&s, x, y, comp, req_comp);
+}
+
+STBIDEF stbi_uc *stbi_load_from_memory_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp,
+                                                stbi_parallel_for *parallel_for, void *context)
+{
+    return stbi__load_from_memory_parallel(buffer, len, x, y, comp, req_comp, parallel_for, context, NULL, 0);
+}
+
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp,
+                                       stbi_uc *out, size_t out_size, stbi_parallel_for *parallel_for, void *context)
+{
+    int file_comp;
+    size_t size;
+    stbi_uc *result = stbi__load_from_memory_parallel(buffer, len, x, y, &file_comp, req_comp, parallel_for, context, out, out_size);
+    if (!result) return 0;
+    if (comp) *comp = file_comp;
+    if (result == out) return 1;
+
+    // decoders and conversions that can't write to out leave the image in a buffer of their own
+    size = (size_t)*x * *y * (req_comp ? req_comp : file_comp);
+    if (size > out_size) {
+        STBI_FREE(result);
+        return stbi__err("buffer too small", "Output buffer too small for image");
+    }
+    memcpy(out, result, size);
+    STBI_FREE(result);
+    return 1;
+}
+
 #ifndef STBI_NO_LINEAR
 static float *stbi__loadf_main(stbi__context *s, int *x, int *y, int *comp, int req_comp)
 {
@@ -3569,7 +3670,7 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
     j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
 
 #ifdef STBI_SSE2
-    if (stbi__sse2_available()) {
+    if (stbi__simd && stbi__sse2_available()) {
         j->idct_block_kernel = stbi__idct_simd;
 #ifndef STBI_JPEG_OLD
         j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -3579,11 +3680,13 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
 #endif
 
 #ifdef STBI_NEON
-    j->idct_block_kernel = stbi__idct_simd;
+    if (stbi__simd) {
+        j->idct_block_kernel = stbi__idct_simd;
 #ifndef STBI_JPEG_OLD
-    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+        j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
 #endif
-    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+        j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+    }
 #endif
 }
 
@@ -3603,6 +3706,91 @@ typedef struct
     int ypos;    // which pre-expansion row we're on
 } stbi__resample;
 
+// set up the resamplers of the first decode_n components for output row 0
+static void stbi__jpeg_resample_setup(stbi__jpeg *z, stbi__resample res_comp[4], int decode_n)
+{
+    int k;
+    for (k = 0; k < decode_n; ++k) {
+        stbi__resample *r = &res_comp[k];
+
+        r->hs = z->img_h_max / z->img_comp[k].h;
+        r->vs = z->img_v_max / z->img_comp[k].v;
+        r->ystep = r->vs >> 1;
+        r->w_lores = (z->s->img_x + r->hs - 1) / r->hs;
+        r->ypos = 0;
+        r->line0 = r->line1 = z->img_comp[k].data;
+
+        if (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+        else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+        else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+        else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+        else                               r->resample = stbi__resample_row_generic;
+    }
+}
+
+// move a resampler on to the next output row
+static void stbi__jpeg_resample_advance(stbi__jpeg *z, stbi__resample *r, int k)
+{
+    if (++r->ystep >= r->vs) {
+        r->ystep = 0;
+        r->line0 = r->line1;
+        if (++r->ypos < z->img_comp[k].y)
+            r->line1 += z->img_comp[k].w2;
+    }
+}
+
+// resample and color-convert output rows [first, last) into output, which points at row first, with res_comp
+// positioned there. 3-component output writes one byte past each row (the 4th channel of the last pixel)
+static void stbi__jpeg_convert_rows(stbi__jpeg *z, stbi__resample res_comp[4], stbi_uc *linebuf[4], stbi_uc *output, int n, int decode_n, stbi__uint32 first, stbi__uint32 last)
+{
+    int k;
+    unsigned int i, j;
+    stbi_uc *coutput[4];
+
+    for (j = first; j < last; ++j) {
+        stbi_uc *out = output + n * z->s->img_x * (j - first);
+        for (k = 0; k < decode_n; ++k) {
+            stbi__resample *r = &res_comp[k];
+            int y_bot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(linebuf[k],
+                y_bot ? r->line1 : r->line0,
+                y_bot ? r->line0 : r->line1,
+                r->w_lores, r->hs);
+            stbi__jpeg_resample_advance(z, r, k);
+        }
+        if (n >= 3) {
+            stbi_uc *y = coutput[0];
+            if (z->s->img_n == 3) {
+                if (z->rgb == 3) {
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        out[0] = y[i];
+                        out[1] = coutput[1][i];
+                        out[2] = coutput[2][i];
+                        out[3] = 255;
+                        out += n;
+                    }
+                }
+                else {
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                }
+            }
+            else
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = out[1] = out[2] = y[i];
+                    out[3] = 255; // not used if n==3
+                    out += n;
+                }
+        }
+        else {
+            stbi_uc *y = coutput[0];
+            if (n == 1)
+                for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
+            else
+                for (i = 0; i < z->s->img_x; ++i) *out++ = y[i], *out++ = 255;
+        }
+    }
+}
+
 static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
 {
     int n, decode_n;
@@ -3625,86 +3813,39 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
     // resample and color-convert
     {
         int k;
-        unsigned int i, j;
         stbi_uc *output;
-        stbi_uc *coutput[4];
+        stbi_uc *linebuf[4];
 
         stbi__resample res_comp[4];
 
         for (k = 0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-
             // allocate line buffer big enough for upsampling off the edges
             // with upsample factor of 4
             z->img_comp[k].linebuf = (stbi_uc *)stbi__malloc(z->s->img_x + 3);
             if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
-            r->hs = z->img_h_max / z->img_comp[k].h;
-            r->vs = z->img_v_max / z->img_comp[k].v;
-            r->ystep = r->vs >> 1;
-            r->w_lores = (z->s->img_x + r->hs - 1) / r->hs;
-            r->ypos = 0;
-            r->line0 = r->line1 = z->img_comp[k].data;
-
-            if (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
-            else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
-            else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
-            else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
-            else                               r->resample = stbi__resample_row_generic;
+            linebuf[k] = z->img_comp[k].linebuf;
         }
+        stbi__jpeg_resample_setup(z, res_comp, decode_n);
 
         // can't error after this so, this is safe
-        output = (stbi_uc *)stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
+        output = stbi__out_buffer_mad3(z->s, n, z->s->img_x, z->s->img_y);
+        if (!output) output = (stbi_uc *)stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
         if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
         // now go ahead and resample
-        for (j = 0; j < z->s->img_y; ++j) {
-            stbi_uc *out = output + n * z->s->img_x * j;
-            for (k = 0; k < decode_n; ++k) {
-                stbi__resample *r = &res_comp[k];
-                int y_bot = r->ystep >= (r->vs >> 1);
-                coutput[k] = r->resample(z->img_comp[k].linebuf,
-                    y_bot ? r->line1 : r->line0,
-                    y_bot ? r->line0 : r->line1,
-                    r->w_lores, r->hs);
-                if (++r->ystep >= r->vs) {
-                    r->ystep = 0;
-                    r->line0 = r->line1;
-                    if (++r->ypos < z->img_comp[k].y)
-                        r->line1 += z->img_comp[k].w2;
-                }
-            }
-            if (n >= 3) {
-                stbi_uc *y = coutput[0];
-                if (z->s->img_n == 3) {
-                    if (z->rgb == 3) {
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            out[0] = y[i];
-                            out[1] = coutput[1][i];
-                            out[2] = coutput[2][i];
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else {
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = out[1] = out[2] = y[i];
-                        out[3] = 255; // not used if n==3
-                        out += n;
-                    }
-            }
-            else {
-                stbi_uc *y = coutput[0];
-                if (n == 1)
-                    for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
-                else
-                    for (i = 0; i < z->s->img_x; ++i) *out++ = y[i], *out++ = 255;
-            }
+        if (output == z->s->out_buffer) {
+            // the caller's buffer has no spare byte for the row converters to write past the end, so the last row goes
+            // through a scratch row
+            size_t stride = (size_t)n * z->s->img_x;
+            stbi_uc *lastrow = (stbi_uc *)stbi__malloc(stride + 1);
+            if (!lastrow) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+            stbi__jpeg_convert_rows(z, res_comp, linebuf, output, n, decode_n, 0, z->s->img_y - 1);
+            stbi__jpeg_convert_rows(z, res_comp, linebuf, lastrow, n, decode_n, z->s->img_y - 1, z->s->img_y);
+            memcpy(output + stride * (z->s->img_y - 1), lastrow, stride);
+            STBI_FREE(lastrow);
         }
+        else
+            stbi__jpeg_convert_rows(z, res_comp, linebuf, output, n, decode_n, 0, z->s->img_y);
         stbi__cleanup_jpeg(z);
         *out_x = z->s->img_x;
         *out_y = z->s->img_y;
@@ -3756,6 +3897,202 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
     STBI_FREE(j);
     return result;
 }
+// parallel decoding of baseline JPEGs with restart intervals. The entropy coder restarts (empty bit buffer, zero DC
+// predictions) at every RSTn marker, so the segments between the markers decode independently, each into its own
+// blocks of the component planes. Resampling and color conversion then run in bands of rows. Anything else (no
+// restart interval, progressive, multiple scans, CMYK, damaged markers) sets *fallback for a serial decode
+
+typedef struct
+{
+    stbi__jpeg *z;
+    stbi_uc **start, **end; // entropy coded bytes of each restart interval
+    int mcus;               // MCUs in the scan; blocks for a single-component scan
+    int *failed;
+} stbi__jpeg_segments;
+
+static void stbi__jpeg_decode_segment(void *data, int index)
+{
+    stbi__jpeg_segments *g = (stbi__jpeg_segments *)data;
+    stbi__jpeg *z = (stbi__jpeg *)stbi__malloc(sizeof(stbi__jpeg));
+    stbi__context s;
+    int mcu, last, k, x, y;
+    STBI_SIMD_ALIGN(short, block[64]);
+
+    if (!z) { g->failed[index] = 1; return; }
+    *z = *g->z;
+    stbi__start_mem(&s, g->start[index], (int)(g->end[index] - g->start[index]));
+    z->s = &s;
+    stbi__jpeg_reset(z);
+    mcu = index * z->restart_interval;
+    last = mcu + z->restart_interval < g->mcus ? mcu + z->restart_interval : g->mcus;
+    for (; mcu < last; ++mcu) {
+        if (z->scan_n == 1) {
+            int n = z->order[0];
+            int w = (z->img_comp[n].x + 7) >> 3;
+            int i = mcu % w, j = mcu / w;
+            int ha = z->img_comp[n].ha;
+            if (!stbi__jpeg_decode_block(z, block, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) { g->failed[index] = 1; break; }
+            z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2*j * 8 + i * 8, z->img_comp[n].w2, block);
+        }
+        else {
+            int i = mcu % z->img_mcu_x, j = mcu / z->img_mcu_x;
+            for (k = 0; k < z->scan_n; ++k) {
+                int n = z->order[k];
+                for (y = 0; y < z->img_comp[n].v; ++y) {
+                    for (x = 0; x < z->img_comp[n].h; ++x) {
+                        int x2 = (i*z->img_comp[n].h + x) * 8;
+                        int y2 = (j*z->img_comp[n].v + y) * 8;
+                        int ha = z->img_comp[n].ha;
+                        if (!stbi__jpeg_decode_block(z, block, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) { g->failed[index] = 1; STBI_FREE(z); return; }
+                        z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2*y2 + x2, z->img_comp[n].w2, block);
+                    }
+                }
+            }
+        }
+    }
+    STBI_FREE(z);
+}
+
+#define STBI__JPEG_BAND_ROWS 64
+
+typedef struct
+{
+    stbi__jpeg *z;
+    stbi_uc *output;
+    int n, decode_n;
+    int *failed;
+} stbi__jpeg_bands;
+
+static void stbi__jpeg_convert_band(void *data, int index)
+{
+    stbi__jpeg_bands *b = (stbi__jpeg_bands *)data;
+    stbi__jpeg *z = b->z;
+    stbi__resample res_comp[4];
+    stbi_uc *linebuf[4] = { NULL, NULL, NULL, NULL };
+    stbi_uc *lastrow;
+    stbi__uint32 first = (stbi__uint32)index * STBI__JPEG_BAND_ROWS, last = first + STBI__JPEG_BAND_ROWS, j;
+    size_t stride = (size_t)b->n * z->s->img_x;
+    int k;
+
+    if (last > z->s->img_y) last = z->s->img_y;
+    // the row converters may write a byte past a row; the band's last row goes through a scratch row so that byte
+    // doesn't land in the next band's first row, which another thread may already have written
+    lastrow = (stbi_uc *)stbi__malloc(stride + 1);
+    if (!lastrow) b->failed[index] = 1;
+    for (k = 0; k < b->decode_n; ++k) {
+        linebuf[k] = (stbi_uc *)stbi__malloc(z->s->img_x + 3);
+        if (!linebuf[k]) b->failed[index] = 1;
+    }
+    if (!b->failed[index]) {
+        // the resamplers only step through rows, so catching up to the band's first row is cheap
+        stbi__jpeg_resample_setup(z, res_comp, b->decode_n);
+        for (j = 0; j < first; ++j)
+            for (k = 0; k < b->decode_n; ++k)
+                stbi__jpeg_resample_advance(z, &res_comp[k], k);
+        stbi__jpeg_convert_rows(z, res_comp, linebuf, b->output + stride * first, b->n, b->decode_n, first, last - 1);
+        stbi__jpeg_convert_rows(z, res_comp, linebuf, lastrow, b->n, b->decode_n, last - 1, last);
+        memcpy(b->output + stride * (last - 1), lastrow, stride);
+    }
+    STBI_FREE(lastrow);
+    for (k = 0; k < b->decode_n; ++k)
+        STBI_FREE(linebuf[k]);
+}
+
+static stbi_uc *stbi__jpeg_load_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, stbi_parallel_for *parallel_for, void *context,
+                                         stbi_uc *out, size_t out_size, int *fallback)
+{
+    stbi__context s;
+    stbi__jpeg *z;
+    stbi__jpeg_segments g;
+    stbi__jpeg_bands b;
+    stbi_uc *p, *output = NULL;
+    int m, i, count = 0, expected, bands, ok = 1;
+
+    *fallback = 1;
+    g.start = g.end = NULL;
+    g.failed = b.failed = NULL;
+    if (req_comp < 0 || req_comp > 4) return NULL;
+    stbi__start_mem(&s, buffer, len);
+    s.out_buffer = out;
+    s.out_buffer_size = out_size;
+    if (!stbi__jpeg_test(&s)) return NULL;
+    z = (stbi__jpeg *)stbi__malloc(sizeof(stbi__jpeg));
+    if (!z) return NULL;
+    z->s = &s;
+    stbi__setup_jpeg(z);
+    for (m = 0; m < 4; m++) {
+        z->img_comp[m].raw_data = NULL;
+        z->img_comp[m].raw_coeff = NULL;
+    }
+    z->restart_interval = 0;
+    z->s->img_n = 0;
+
+    // headers up to the first scan, as stbi__decode_jpeg_image reads them
+    if (!stbi__decode_jpeg_header(z, STBI__SCAN_load)) goto done;
+    if (z->progressive || z->s->img_n > 3) goto done; // CMYK keeps the 4th DC prediction across restarts in the serial path
+    m = stbi__get_marker(z);
+    while (!stbi__SOS(m)) {
+        if (stbi__EOI(m) || !stbi__process_marker(z, m)) goto done;
+        m = stbi__get_marker(z);
+    }
+    if (!stbi__process_scan_header(z) || !z->restart_interval || z->scan_n != z->s->img_n) goto done;
+
+    // split the entropy coded data at the restart markers, which must be all there and in sequence
+    g.z = z;
+    g.mcus = z->scan_n == 1 ? ((z->img_comp[z->order[0]].x + 7) >> 3) * ((z->img_comp[z->order[0]].y + 7) >> 3) : z->img_mcu_x * z->img_mcu_y;
+    expected = (g.mcus + z->restart_interval - 1) / z->restart_interval;
+    g.start = (stbi_uc **)stbi__malloc_mad2(expected, sizeof(stbi_uc *), 0);
+    g.end = (stbi_uc **)stbi__malloc_mad2(expected, sizeof(stbi_uc *), 0);
+    g.failed = (int *)stbi__malloc_mad2(expected, sizeof(int), 0);
+    if (!g.start || !g.end || !g.failed) goto done;
+    memset(g.failed, 0, expected * sizeof(int));
+    p = s.img_buffer;
+    g.start[0] = p;
+    for (;;) {
+        if (p + 1 >= s.img_buffer_end) { p = s.img_buffer_end; break; }
+        if (p[0] != 0xff || p[1] == 0xff) { ++p; continue; }
+        if (p[1] == 0x00) { p += 2; continue; } // stuffed 0xff data byte
+        if (!STBI__RESTART(p[1])) break;        // any other marker ends the scan
+        if (p[1] != 0xd0 + (count & 7) || count + 1 >= expected) { ok = 0; break; }
+        g.end[count++] = p;
+        p += 2;
+        g.start[count] = p;
+    }
+    g.end[count++] = p;
+    if (!ok || count != expected) goto done;
+
+    parallel_for(context, count, stbi__jpeg_decode_segment, &g);
+    for (i = 0; i < count; ++i)
+        if (g.failed[i]) goto done;
+
+    b.z = z;
+    b.n = req_comp ? req_comp : z->s->img_n;
+    b.decode_n = (z->s->img_n == 3 && b.n < 3) ? 1 : z->s->img_n;
+    bands = (z->s->img_y + STBI__JPEG_BAND_ROWS - 1) / STBI__JPEG_BAND_ROWS;
+    b.failed = (int *)stbi__malloc_mad2(bands, sizeof(int), 0);
+    // every band writes its last row through a scratch row, so the caller's buffer needs no spare byte
+    b.output = stbi__out_buffer_mad3(&s, b.n, z->s->img_x, z->s->img_y);
+    if (!b.output) b.output = (stbi_uc *)stbi__malloc_mad3(b.n, z->s->img_x, z->s->img_y, 1);
+    if (!b.failed || !b.output) { stbi__free_output(&s, b.output); goto done; }
+    memset(b.failed, 0, bands * sizeof(int));
+    parallel_for(context, bands, stbi__jpeg_convert_band, &b);
+    for (i = 0; i < bands; ++i)
+        if (b.failed[i]) { stbi__free_output(&s, b.output); goto done; }
+
+    output = b.output;
+    *x = z->s->img_x;
+    *y = z->s->img_y;
+    if (comp) *comp = z->s->img_n;
+    *fallback = 0;
+done:
+    stbi__cleanup_jpeg(z);
+    STBI_FREE(g.start);
+    STBI_FREE(g.end);
+    STBI_FREE(g.failed);
+    STBI_FREE(b.failed);
+    STBI_FREE(z);
+    return output;
+}
 #endif
 
 // public domain zlib decode    v0.2  Sean Barrett 2006-11-18
@@ -3875,6 +4212,17 @@ stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
 
 static void stbi__fill_bits(stbi__zbuf *z)
 {
+    if (stbi__simd && z->zbuffer_end - z->zbuffer >= 4) {
+        // all the whole bytes the bit buffer has room for, from one little-endian word
+        int bytes = (32 - z->num_bits) >> 3;
+        stbi__uint32 word = (stbi__uint32)z->zbuffer[0] | ((stbi__uint32)z->zbuffer[1] << 8) | ((stbi__uint32)z->zbuffer[2] << 16) | ((stbi__uint32)z->zbuffer[3] << 24);
+        STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
+        if (bytes < 4) word &= (1U << (bytes * 8)) - 1;
+        z->code_buffer |= word << z->num_bits;
+        z->zbuffer += bytes;
+        z->num_bits += bytes * 8;
+        return;
+    }
     do {
         STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
         z->code_buffer |= (unsigned int)stbi__zget8(z) << z->num_bits;
@@ -3994,6 +4342,13 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
                 stbi_uc v = *p;
                 if (len) { do *zout++ = v; while (--len); }
             }
+            else if (stbi__simd && dist >= 8 && zout + len + 8 <= a->zout_end) {
+                // 8 bytes at a time, possibly past the end of the match into unused buffer; chunks at least 8 apart
+                // don't overlap, and later chunks read what earlier ones wrote just as the byte loop does
+                char *end = zout + len;
+                do { memcpy(zout, p, 8); zout += 8; p += 8; } while (zout < end);
+                zout = end;
+            }
             else {
                 if (len) { do *zout++ = *p++; while (--len); }
             }
@@ -4266,6 +4621,7 @@ typedef struct
     stbi__context *s;
     stbi_uc *idata, *expanded, *out;
     int depth;
+    int to_out; // out is the final image, so it may be the caller's buffer
 } stbi__png;
 
 
@@ -4302,6 +4658,73 @@ static int stbi__paeth(int a, int b, int c)
 
 static stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// SSE2 versions of the row filters, bit exact with the loops in stbi__create_png_image_raw. up works on 16 bytes at
+// a time for any pixel size; paeth depends on the pixel to its left and goes one 3 or 4 byte pixel per step, doing
+// the three distance compares for all channels at once. Returns 0 for the cases left to the scalar code
+stbi_inline static __m128i stbi__png_load_pixel(stbi_uc const *p, int bpp)
+{
+    int v = 0;
+    memcpy(&v, p, bpp);
+    return _mm_cvtsi32_si128(v);
+}
+
+stbi_inline static void stbi__png_store_pixel(stbi_uc *p, __m128i v, int bpp)
+{
+    int x = _mm_cvtsi128_si32(v);
+    memcpy(p, &x, bpp);
+}
+
+stbi_inline static __m128i stbi__png_select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+stbi_inline static __m128i stbi__png_abs16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static int stbi__png_unfilter_simd(int filter, stbi_uc *cur, stbi_uc const *raw, stbi_uc const *prior, int nk, int bpp)
+{
+    __m128i zero = _mm_setzero_si128();
+    int k = 0;
+
+    if (filter == STBI__F_up) {
+        for (; k + 16 <= nk; k += 16)
+            _mm_storeu_si128((__m128i *)(cur + k), _mm_add_epi8(_mm_loadu_si128((__m128i const *)(raw + k)), _mm_loadu_si128((__m128i const *)(prior + k))));
+        for (; k < nk; ++k)
+            cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+        return 1;
+    }
+    if (bpp != 3 && bpp != 4)
+        return 0;
+
+    // sub and avg are one add per byte along a serial dependency; the scalar loop is already as fast as a pixel at a time
+    if (filter == STBI__F_paeth) {
+        __m128i a = _mm_unpacklo_epi8(stbi__png_load_pixel(cur - bpp, bpp), zero);
+        __m128i c = _mm_unpacklo_epi8(stbi__png_load_pixel(prior - bpp, bpp), zero);
+        for (; k < nk; k += bpp) {
+            __m128i b = _mm_unpacklo_epi8(stbi__png_load_pixel(prior + k, bpp), zero);
+            // p = a + b - c, so |p - a| = |b - c|, |p - b| = |a - c| and |p - c| = |(b - c) + (a - c)|
+            __m128i pa = _mm_sub_epi16(b, c), pb = _mm_sub_epi16(a, c);
+            __m128i pc = stbi__png_abs16(_mm_add_epi16(pa, pb));
+            __m128i smallest, predictor, x;
+            pa = stbi__png_abs16(pa);
+            pb = stbi__png_abs16(pb);
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            predictor = stbi__png_select(_mm_cmpeq_epi16(pa, smallest), a, stbi__png_select(_mm_cmpeq_epi16(pb, smallest), b, c));
+            x = _mm_add_epi8(_mm_packus_epi16(predictor, predictor), stbi__png_load_pixel(raw + k, bpp));
+            stbi__png_store_pixel(cur + k, x, bpp);
+            a = _mm_unpacklo_epi8(x, zero);
+            c = b;
+        }
+        return 1;
+    }
+    return 0;
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4317,7 +4740,8 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
     int width = x;
 
     STBI_ASSERT(out_n == s->img_n || out_n == s->img_n + 1);
-    a->out = (stbi_uc *)stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
+    a->out = a->to_out ? stbi__out_buffer_mad3(s, x, y, output_bytes) : NULL;
+    if (!a->out) a->out = (stbi_uc *)stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
     if (!a->out) return stbi__err("outofmem", "Out of memory");
 
     img_width_bytes = (((img_n * x * depth) + 7) >> 3);
@@ -4385,10 +4809,15 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
         // this is a little gross, so that we don't switch per-pixel or per-component
         if (depth < 8 || img_n == out_n) {
             int nk = (width - 1)*filter_bytes;
+            int done = 0;
+#ifdef STBI_SSE2
+            if (stbi__simd && stbi__sse2_available())
+                done = stbi__png_unfilter_simd(filter, cur, raw, prior, nk, filter_bytes);
+#endif
 #define STBI__CASE(f) \
              case f:     \
                 for (k=0; k < nk; ++k)
-            switch (filter) {
+            if (!done) switch (filter) {
                 // "none" filter turns into a memcpy here; make that explicit.
             case STBI__F_none:         memcpy(cur, raw, nk); break;
                 STBI__CASE(STBI__F_sub) { cur[k] = STBI__BYTECAST(raw[k] + cur[k - filter_bytes]); } break;
@@ -4530,8 +4959,10 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint3
     if (!interlaced)
         return stbi__create_png_image_raw(a, image_data, image_data_len, out_n, a->s->img_x, a->s->img_y, depth, color);
 
-    // de-interlacing
-    final = (stbi_uc *)stbi__malloc_mad3(a->s->img_x, a->s->img_y, out_bytes, 0);
+    // de-interlacing; only the final image may go to the caller's buffer, the passes get their own
+    final = a->to_out ? stbi__out_buffer_mad3(a->s, a->s->img_x, a->s->img_y, out_bytes) : NULL;
+    if (!final) final = (stbi_uc *)stbi__malloc_mad3(a->s->img_x, a->s->img_y, out_bytes, 0);
+    a->to_out = 0;
     for (p = 0; p < 7; ++p) {
         int xorig[] = { 0,4,0,2,0,1,0 };
         int yorig[] = { 0,0,4,0,2,0,1 };
@@ -4544,7 +4975,7 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint3
         if (x && y) {
             stbi__uint32 img_len = ((((a->s->img_n * x * depth) + 7) >> 3) + 1) * y;
             if (!stbi__create_png_image_raw(a, image_data, image_data_len, out_n, x, y, depth, color)) {
-                STBI_FREE(final);
+                stbi__free_output(a->s, final);
                 return 0;
             }
             for (j = 0; j < y; ++j) {
@@ -4843,6 +5274,8 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
                 s->img_out_n = s->img_n + 1;
             else
                 s->img_out_n = s->img_n;
+            // the image is final unless a palette expansion, 16 to 8 bit reduction or channel conversion still follows
+            z->to_out = z->depth != 16 && !pal_img_n && (req_comp == 0 || req_comp == s->img_out_n);
             if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
             if (has_trans) {
                 if (z->depth == 16) {
@@ -4911,7 +5344,7 @@ static void *stbi__do_png(stbi__png *p, int *x, int *y, int *n, int req_comp, st
         *y = p->s->img_y;
         if (n) *n = p->s->img_n;
     }
-    STBI_FREE(p->out);      p->out = NULL;
+    stbi__free_output(p->s, p->out); p->out = NULL;
     STBI_FREE(p->expanded); p->expanded = NULL;
     STBI_FREE(p->idata);    p->idata = NULL;
 
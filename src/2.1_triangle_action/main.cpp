@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <learnopengl/gl_state.h>
 #include <iostream>
 
 using namespace std;
@@ -32,13 +33,13 @@ const unsigned int SCR_HEIGHT = 1200;
 void UpdateVertexData(GLuint VAO, GLuint VBO)
 {
   // Update Vertex Data
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  GLState::bindVertexArray(VAO);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+  GLState::bindVertexArray(0);
 }
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
@@ -227,16 +228,16 @@ int main()
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
 
-  glBindVertexArray(VAO);
+  GLState::bindVertexArray(VAO);
 
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
 
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+  GLState::bindVertexArray(0);
 
   // render loop
   while (!glfwWindowShouldClose(window))
@@ -246,18 +247,23 @@ int main()
 
     glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
+    GLState::useProgram(shaderProgram);
+    GLState::bindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 3);
 
+    GLState::endFrame();
+
     // check and call events and swap the buffers
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
   glDeleteVertexArrays(1, &VAO);
+  GLState::forgetVertexArray(VAO);
   glDeleteBuffers(1, &VBO);
+  GLState::forgetBuffer(VBO);
   glDeleteProgram(shaderProgram);
+  GLState::forgetProgram(shaderProgram);
 
   glfwDestroyWindow(window);
   glfwTerminate();
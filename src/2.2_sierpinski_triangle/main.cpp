@@ -78,7 +78,7 @@ void updateVertices()
   vertices.clear();
   generateVertices(vertices, A, B, C, depth);
 
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 }
 
@@ -157,14 +157,14 @@ int main()
 
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  GLState::bindVertexArray(VAO);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
 
   // Clear bind
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+  GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+  GLState::bindVertexArray(0);
 
   // first generate
   updateVertices();
@@ -178,17 +178,21 @@ int main()
     glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(ourShader.ID);
-    glBindVertexArray(VAO);
+    GLState::useProgram(ourShader.ID);
+    GLState::bindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 3);
 
+    GLState::endFrame();
+
     // check and call events and swap the buffers
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
   glDeleteVertexArrays(1, &VAO);
+  GLState::forgetVertexArray(VAO);
   glDeleteBuffers(1, &VBO);
+  GLState::forgetBuffer(VBO);
 
   glfwDestroyWindow(window);
   glfwTerminate();
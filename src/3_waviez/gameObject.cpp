@@ -1,11 +1,10 @@
 #include "gameObject.h"
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include <learnopengl/shader_t.h>
 
 GameObject::GameObject(Shader shaderProgram)
     : position(0.0f), scale(1.0f), objColor(1.0f), transformMatrix(1.0f),
-      velocity(0.0f), gravity(-9.8f), shader(shaderProgram), clampedDirection(0, 1, 0), alive(true), jumpImpulse(0.1f) {}
+      velocity(0.0f), gravity(-9.8f), shader(shaderProgram), bindings(shader), clampedDirection(0, 1, 0), alive(true), jumpImpulse(0.1f) {}
 
 void GameObject::draw()
 {
@@ -13,10 +12,8 @@ void GameObject::draw()
     if (!alive) return;
 
     shader.use();
-    shader.setVec3("objColor", objColor);
-
-    GLuint transformLoc = glGetUniformLocation(shader.ID, "transform");
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transformMatrix));
+    bindings.set(ShaderProgram::objColor, objColor);
+    bindings.set(ShaderProgram::transform, transformMatrix);
 }
 
 void GameObject::update(float deltaTime)
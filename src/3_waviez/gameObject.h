@@ -2,10 +2,13 @@
 #include <glm/glm.hpp>
 #include <learnopengl/shader_t.h>
 
+#include "shader_bindings.h"
+
 class GameObject
 {
 public:
     Shader shader;
+    ProgramBindings<ShaderProgram> bindings;
     glm::vec3 position, scale;
     float rotation; // in degrees
     glm::vec3 objColor;
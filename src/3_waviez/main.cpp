@@ -11,6 +11,7 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <cstdlib>
 
 #include "gameObject.h"
 
@@ -197,18 +198,24 @@ int main()
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLState::bindVertexArray(VAO);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    // build and compile shader
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::bindVertexArray(0);
+
+    // build and compile shader. With LEARNOPENGL_SHADER_CACHE set to a directory, program binaries are kept there and
+    // reused on later runs while the driver still accepts them
+    const char *shaderCache = getenv("LEARNOPENGL_SHADER_CACHE");
+    if (shaderCache && *shaderCache)
+        ProgramCache::enable(shaderCache);
     Shader shaderProgram("shader.vs", "shader.fs");
+    if (shaderCache && *shaderCache)
+        ProgramCache::report();
 
     // Player setup
     GameObject player(shaderProgram);
@@ -273,13 +280,13 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
 
         player.draw();
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
         for (auto &obj : objects)
         {
             obj->draw();
-            glBindVertexArray(VAO);
+            GLState::bindVertexArray(VAO);
             glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         }
 
@@ -289,6 +296,8 @@ int main()
                                 { return !obj->alive; }),
                       objects.end());
 
+        UniformTable::endFrame();
+        GLState::endFrame();
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
@@ -1,2 +1,6 @@
 #define STB_IMAGE_IMPLEMENTATION
+// stb_image detects SSE2 by itself but only uses its NEON JPEG kernels when asked; ARM builds (Apple silicon) get them here
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STBI_NEON
+#endif
 #include "stb_image.h"
\ No newline at end of file
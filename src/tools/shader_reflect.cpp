@@ -0,0 +1,586 @@
+// shader_reflect: offline reflection of a chapter's GLSL programs into a header of typed uniform bindings.
+//
+//     shader_reflect <output header> <program.vs | program.cs>...
+//
+// every X.vs is a program together with X.fs and, where present, X.gs, X.tcs and X.tes; every X.cs is a compute
+// program. The sources are read through ShaderSource (so #include works as at run time) and their uniforms parsed,
+// without a GL context. Each program becomes a struct XProgram with
+//   - a UniformSlot / UniformArraySlot / SamplerSlot per uniform, for ProgramBindings<XProgram> (program_bindings.h),
+//     so a misspelled uniform or a value of the wrong type doesn't compile
+//   - fixed texture units for the samplers, assigned in declaration order
+//   - the std140 offsets and size of each std140 uniform block
+// struct uniforms are flattened (light.color becomes light_color). Preprocessor conditionals aren't evaluated, so
+// uniforms of every branch are listed; array sizes may be literals or #defines of the file itself.
+// the header is only rewritten when it changes, so an unchanged shader doesn't rebuild its chapter; the build touches a
+// stamp file next to it to record that the reflection ran
+#include <learnopengl/frame_constants.h>
+#include <learnopengl/shader_source.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Member {
+    string type;
+    string name;
+    int arraySize; // 0 when not an array
+};
+
+struct Uniform {
+    string name;     // GLSL name, e.g. light.color or bones
+    string type;     // GLSL type
+    int arraySize;   // 0 when not an array
+    int unit;        // first texture unit of a sampler, -1 otherwise
+};
+
+struct Block {
+    string name;
+    bool std140;
+    vector<Member> members;
+};
+
+struct Program {
+    string name;
+    vector<string> files;
+    vector<Uniform> uniforms;
+    vector<Block> blocks;
+    map<string, vector<Member>> structs;
+};
+
+static bool failed = false;
+
+static void warn(const string &file, const string &message)
+{
+    cerr << "shader_reflect: " << file << ": " << message << endl;
+}
+
+// the source without comments and preprocessor lines, collecting #define NAME <integer> on the way
+static string strip(const string &source, map<string, int> &defines)
+{
+    string code;
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        if (source.compare(i, 2, "//") == 0)
+            i = min(source.find('\n', i), source.size()) - 1;
+        else if (source.compare(i, 2, "/*") == 0)
+        {
+            size_t end = source.find("*/", i + 2);
+            i = end == string::npos ? source.size() : end + 1;
+            code += ' ';
+        }
+        else
+            code += source[i];
+    }
+    istringstream lines(code);
+    string line, result;
+    while (getline(lines, line))
+    {
+        size_t at = line.find_first_not_of(" \t");
+        if (at == string::npos || line[at] != '#')
+        {
+            result += line + '\n';
+            continue;
+        }
+        istringstream directive(line.substr(at + 1));
+        string keyword, name, value;
+        directive >> keyword >> name >> value;
+        if (keyword == "define" && !value.empty() && all_of(value.begin(), value.end(), [](char c) { return isdigit((unsigned char)c); }))
+            defines[name] = stoi(value);
+    }
+    return result;
+}
+
+static vector<string> tokenize(const string &code)
+{
+    vector<string> tokens;
+    for (size_t i = 0; i < code.size();)
+    {
+        unsigned char c = code[i];
+        if (isspace(c))
+            i++;
+        else if (isalnum(c) || c == '_')
+        {
+            size_t start = i;
+            while (i < code.size() && (isalnum((unsigned char)code[i]) || code[i] == '_' || code[i] == '.'))
+                i++;
+            tokens.push_back(code.substr(start, i - start));
+        }
+        else
+            tokens.push_back(string(1, code[i++]));
+    }
+    return tokens;
+}
+
+class Parser
+{
+public:
+    Parser(const string &file, const vector<string> &tokens, map<string, int> &defines)
+        : file(file), tokens(tokens), defines(defines)
+    {
+    }
+
+    void parse(map<string, vector<Member>> &structs, vector<Member> &uniforms, vector<Block> &blocks)
+    {
+        while (at < tokens.size())
+        {
+            size_t start = at;
+            bool std140 = false;
+            if (peek() == "layout")
+                std140 = skipLayout();
+            if (peek() == "const" && at + 4 < tokens.size() && tokens[at + 1] == "int" && tokens[at + 3] == "=" && isNumber(tokens[at + 4]))
+                defines[tokens[at + 2]] = stoi(tokens[at + 4]); // const int MAX_BONES = 100; sizes arrays like a #define
+            else if (peek() == "struct")
+            {
+                at++;
+                string name = next();
+                if (peek() == "{")
+                {
+                    at++;
+                    structs[name] = members('}');
+                }
+            }
+            else if (peek() == "uniform")
+            {
+                at++;
+                skipQualifiers();
+                if (at + 1 < tokens.size() && tokens[at + 1] == "{")
+                {
+                    Block block;
+                    block.name = next();
+                    block.std140 = std140;
+                    at++;
+                    block.members = members('}');
+                    blocks.push_back(block);
+                }
+                else
+                {
+                    vector<Member> declared = declaration();
+                    uniforms.insert(uniforms.end(), declared.begin(), declared.end());
+                }
+            }
+            skipStatement(start);
+        }
+    }
+
+private:
+    const string &file;
+    const vector<string> &tokens;
+    map<string, int> &defines;
+    size_t at = 0;
+
+    static bool isNumber(const string &token)
+    {
+        return !token.empty() && all_of(token.begin(), token.end(), [](char c) { return isdigit((unsigned char)c); });
+    }
+
+    const string& peek() const
+    {
+        static const string end;
+        return at < tokens.size() ? tokens[at] : end;
+    }
+
+    string next()
+    {
+        return at < tokens.size() ? tokens[at++] : string();
+    }
+
+    // layout(...), true when it asks for std140
+    bool skipLayout()
+    {
+        bool std140 = false;
+        at++;
+        if (peek() != "(")
+            return false;
+        while (at < tokens.size() && tokens[at] != ")")
+            std140 |= tokens[at++] == "std140";
+        at++;
+        return std140;
+    }
+
+    void skipQualifiers()
+    {
+        static const set<string> qualifiers = { "highp", "mediump", "lowp", "row_major", "column_major", "flat", "smooth", "const" };
+        while (qualifiers.count(peek()))
+            at++;
+    }
+
+    int arraySize()
+    {
+        if (peek() != "[")
+            return 0;
+        at++;
+        string size = next();
+        int value = 0;
+        if (isNumber(size))
+            value = stoi(size);
+        else if (defines.count(size))
+            value = defines.at(size);
+        else
+            warn(file, "array size " + size + " isn't known without the run time defines, taken as 1");
+        while (at < tokens.size() && tokens[at] != "]")
+            at++;
+        at++;
+        return max(value, 1);
+    }
+
+    // type name[, name...]; the cursor ends on the ';'
+    vector<Member> declaration()
+    {
+        vector<Member> declared;
+        skipQualifiers();
+        string type = next();
+        while (at < tokens.size() && peek() != ";")
+        {
+            Member member;
+            member.type = type;
+            member.name = next();
+            member.arraySize = arraySize();
+            declared.push_back(member);
+            if (peek() == ",")
+                at++;
+            else if (peek() != ";")
+                break;
+        }
+        return declared;
+    }
+
+    // the member declarations up to the closing brace, which is consumed
+    vector<Member> members(char close)
+    {
+        vector<Member> list;
+        while (at < tokens.size() && peek() != string(1, close))
+        {
+            if (peek() == "layout")
+                skipLayout();
+            vector<Member> declared = declaration();
+            list.insert(list.end(), declared.begin(), declared.end());
+            while (at < tokens.size() && peek() != ";" && peek() != string(1, close))
+                at++;
+            if (peek() == ";")
+                at++;
+        }
+        at++;
+        return list;
+    }
+
+    // to the end of the statement starting at start: a ';' outside braces, or the brace closing a function body
+    void skipStatement(size_t start)
+    {
+        if (at <= start)
+            at = start;
+        int depth = 0;
+        bool function = false;
+        while (at < tokens.size())
+        {
+            const string &token = tokens[at++];
+            if (token == "{")
+            {
+                if (depth++ == 0)
+                    function = at >= 2 && tokens[at - 2] == ")";
+            }
+            else if (token == "}" && --depth == 0 && function)
+                return;
+            else if (token == ";" && depth == 0)
+                return;
+        }
+    }
+};
+
+// base alignment and size of a GLSL type in a std140 block; arrays and structs are handled by the caller
+static bool std140Type(const string &type, size_t &alignment, size_t &size)
+{
+    static const map<string, pair<size_t, size_t>> types = {
+        { "float", { 4, 4 } }, { "int", { 4, 4 } }, { "uint", { 4, 4 } }, { "bool", { 4, 4 } },
+        { "vec2", { 8, 8 } }, { "ivec2", { 8, 8 } }, { "uvec2", { 8, 8 } }, { "bvec2", { 8, 8 } },
+        { "vec3", { 16, 12 } }, { "ivec3", { 16, 12 } }, { "uvec3", { 16, 12 } }, { "bvec3", { 16, 12 } },
+        { "vec4", { 16, 16 } }, { "ivec4", { 16, 16 } }, { "uvec4", { 16, 16 } }, { "bvec4", { 16, 16 } },
+        { "mat2", { 16, 32 } }, { "mat3", { 16, 48 } }, { "mat4", { 16, 64 } },
+    };
+    auto found = types.find(type);
+    if (found == types.end())
+        return false;
+    alignment = found->second.first;
+    size = found->second.second;
+    return true;
+}
+
+static size_t alignUp(size_t offset, size_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// std140 offsets of members, as (GLSL name, offset), struct members flattened; returns the size (struct rules)
+static size_t std140Layout(const vector<Member> &members, const map<string, vector<Member>> &structs, const string &prefix,
+                           size_t base, vector<pair<string, size_t>> &offsets, const string &file)
+{
+    size_t offset = 0, largest = 16;
+    for (const Member &member : members)
+    {
+        size_t alignment = 0, size = 0;
+        auto structType = structs.find(member.type);
+        vector<pair<string, size_t>> nested;
+        if (structType != structs.end())
+        {
+            alignment = 16;
+            size = std140Layout(structType->second, structs, "", 0, nested, file);
+        }
+        else if (!std140Type(member.type, alignment, size))
+        {
+            warn(file, "no std140 layout for " + member.type + " " + member.name);
+            failed = true;
+            return 0;
+        }
+        size_t stride = size;
+        if (member.arraySize > 0)
+        {
+            alignment = alignUp(alignment, 16);
+            stride = alignUp(size, 16);
+        }
+        offset = alignUp(offset, alignment);
+        offsets.emplace_back(prefix + member.name, base + offset);
+        for (const auto &field : nested)
+            offsets.emplace_back(prefix + member.name + '.' + field.first, base + offset + field.second);
+        offset += stride * (member.arraySize > 0 ? member.arraySize : 1);
+        largest = max(largest, alignment);
+    }
+    return alignUp(offset, largest);
+}
+
+// a uniform for every basic member, with struct uniforms (and arrays of them) flattened to name.member
+static void flatten(const Member &member, const map<string, vector<Member>> &structs, const string &prefix, vector<Uniform> &out)
+{
+    auto structType = structs.find(member.type);
+    if (structType == structs.end())
+    {
+        out.push_back(Uniform{prefix + member.name, member.type, member.arraySize, -1});
+        return;
+    }
+    int count = member.arraySize > 0 ? member.arraySize : 1;
+    for (int i = 0; i < count; i++)
+    {
+        string name = prefix + member.name + (member.arraySize > 0 ? '[' + to_string(i) + ']' : string()) + '.';
+        for (const Member &field : structType->second)
+            flatten(field, structs, name, out);
+    }
+}
+
+static bool reflect(Program &program)
+{
+    map<string, vector<Member>> &structs = program.structs;
+    for (const string &file : program.files)
+    {
+        map<string, int> defines;
+        string source = ShaderSource::load(file);
+        if (source.empty())
+        {
+            warn(file, "couldn't be read");
+            return false;
+        }
+        vector<string> tokens = tokenize(strip(source, defines));
+        vector<Member> declared;
+        vector<Block> blocks;
+        Parser(file, tokens, defines).parse(structs, declared, blocks);
+
+        vector<Uniform> flattened;
+        for (const Member &member : declared)
+            flatten(member, structs, "", flattened);
+        for (const Uniform &uniform : flattened)
+        {
+            auto same = find_if(program.uniforms.begin(), program.uniforms.end(), [&](const Uniform &u) { return u.name == uniform.name; });
+            if (same == program.uniforms.end())
+                program.uniforms.push_back(uniform);
+            else if (same->type != uniform.type || same->arraySize != uniform.arraySize)
+                warn(file, uniform.name + " is declared as both " + same->type + " and " + uniform.type + ", keeping the first");
+        }
+        for (const Block &block : blocks)
+            if (none_of(program.blocks.begin(), program.blocks.end(), [&](const Block &b) { return b.name == block.name; }))
+                program.blocks.push_back(block);
+    }
+
+    int unit = 0;
+    for (Uniform &uniform : program.uniforms)
+        if (uniform.type.compare(0, 7, "sampler") == 0 || uniform.type.compare(0, 8, "isampler") == 0 || uniform.type.compare(0, 8, "usampler") == 0)
+        {
+            uniform.unit = unit;
+            unit += max(uniform.arraySize, 1);
+        }
+    return true;
+}
+
+static string identifier(const string &name)
+{
+    static const set<string> keywords = { "default", "register", "class", "new", "delete", "this", "template", "operator", "union", "private", "public", "protected", "friend" };
+    string result;
+    for (char c : name)
+    {
+        if (isalnum((unsigned char)c) || c == '_')
+            result += c;
+        else if (!result.empty() && result.back() != '_')
+            result += '_';
+    }
+    while (!result.empty() && result.back() == '_')
+        result.pop_back();
+    if (result.empty() || isdigit((unsigned char)result[0]) || keywords.count(result))
+        result = '_' + result;
+    return result;
+}
+
+static string structName(const string &path)
+{
+    string base = path.substr(path.find_last_of("/\\") + 1);
+    base = base.substr(0, base.find('.'));
+    string name;
+    bool upper = true;
+    for (char c : base)
+    {
+        if (!isalnum((unsigned char)c))
+        {
+            upper = true;
+            continue;
+        }
+        name += upper ? (char)toupper((unsigned char)c) : c;
+        upper = false;
+    }
+    if (name.empty() || isdigit((unsigned char)name[0]))
+        name = 'P' + name;
+    return name + "Program";
+}
+
+static string cppType(const string &type)
+{
+    static const map<string, string> types = {
+        { "float", "float" }, { "int", "int" }, { "uint", "unsigned int" }, { "bool", "bool" },
+        { "vec2", "glm::vec2" }, { "vec3", "glm::vec3" }, { "vec4", "glm::vec4" },
+        { "ivec2", "glm::ivec2" }, { "ivec3", "glm::ivec3" }, { "ivec4", "glm::ivec4" },
+        { "uvec2", "glm::uvec2" }, { "uvec3", "glm::uvec3" }, { "uvec4", "glm::uvec4" },
+        { "bvec2", "glm::bvec2" }, { "bvec3", "glm::bvec3" }, { "bvec4", "glm::bvec4" },
+        { "mat2", "glm::mat2" }, { "mat3", "glm::mat3" }, { "mat4", "glm::mat4" },
+    };
+    auto found = types.find(type);
+    return found == types.end() ? string() : found->second;
+}
+
+static string emit(const Program &program)
+{
+    ostringstream out;
+    out << "// ";
+    for (size_t i = 0; i < program.files.size(); i++)
+        out << (i ? ", " : "") << program.files[i].substr(program.files[i].find_last_of("/\\") + 1);
+    out << "\nstruct " << program.name << " {\n";
+    out << "    static constexpr unsigned int kUniformCount = " << program.uniforms.size() << ";\n";
+    out << "    static constexpr const char *kUniformNames[kUniformCount + 1] = { ";
+    for (const Uniform &uniform : program.uniforms)
+        out << '"' << uniform.name << "\", ";
+    out << "nullptr };\n";
+    out << "    static constexpr GLint kUniformSizes[kUniformCount + 1] = { ";
+    for (const Uniform &uniform : program.uniforms)
+        out << max(uniform.arraySize, 1) << ", ";
+    out << "0 };\n";
+    out << "    static constexpr GLint kSamplerUnits[kUniformCount + 1] = { ";
+    for (const Uniform &uniform : program.uniforms)
+        out << uniform.unit << ", ";
+    out << "-1 };\n\n";
+
+    for (size_t i = 0; i < program.uniforms.size(); i++)
+    {
+        const Uniform &uniform = program.uniforms[i];
+        const string name = identifier(uniform.name);
+        if (uniform.unit >= 0)
+            out << "    static constexpr SamplerSlot " << name << "{" << i << ", " << uniform.unit << "};";
+        else if (cppType(uniform.type).empty())
+            out << "    // " << uniform.type << " " << uniform.name << " has no C++ type to set it with";
+        else if (uniform.arraySize > 0)
+            out << "    static constexpr UniformArraySlot<" << cppType(uniform.type) << "> " << name << "{" << i << ", " << uniform.arraySize << "};";
+        else
+            out << "    static constexpr UniformSlot<" << cppType(uniform.type) << "> " << name << "{" << i << "};";
+        out << "\n";
+    }
+
+    for (const Block &block : program.blocks)
+    {
+        out << "\n    // uniform block " << block.name << "\n";
+        if (!block.std140)
+        {
+            out << "    // not std140, so its layout is up to the driver\n";
+            continue;
+        }
+        vector<pair<string, size_t>> offsets;
+        size_t size = std140Layout(block.members, program.structs, "", 0, offsets, program.files[0]);
+        out << "    struct " << identifier(block.name) << " {\n";
+        out << "        static constexpr size_t size = " << size << ";\n";
+        for (const auto &offset : offsets)
+            out << "        static constexpr size_t " << identifier(offset.first) << " = " << offset.second << ";\n";
+        out << "    };\n";
+    }
+    out << "};\n";
+    return out.str();
+}
+
+static bool exists(const string &path)
+{
+    return ifstream(path).good();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "usage: shader_reflect <output header> <program.vs | program.cs>..." << endl;
+        return 1;
+    }
+    // the blocks the library registers at run time, so shaders including them parse here too
+    ShaderSource::addFile("frame_constants.glsl", FrameUniforms::kSource);
+
+    const string output = argv[1];
+    ostringstream header;
+    header << "// generated by shader_reflect from the shaders next to this chapter's sources; changes are overwritten\n"
+           << "#pragma once\n\n#include <cstddef>\n\n#include <learnopengl/program_bindings.h>\n";
+    for (int i = 2; i < argc; i++)
+    {
+        const string path = argv[i];
+        const string base = path.substr(0, path.find_last_of('.'));
+        const string extension = path.substr(path.find_last_of('.') + 1);
+        Program program;
+        program.name = structName(path);
+        program.files.push_back(path);
+        if (extension == "vs")
+        {
+            if (!exists(base + ".fs"))
+            {
+                warn(path, "has no " + base + ".fs");
+                failed = true;
+                continue;
+            }
+            program.files.push_back(base + ".fs");
+            for (const char *stage : { ".gs", ".tcs", ".tes" })
+                if (exists(base + stage))
+                    program.files.push_back(base + stage);
+        }
+        if (!reflect(program))
+        {
+            failed = true;
+            continue;
+        }
+        header << '\n' << emit(program);
+    }
+    if (failed)
+        return 1;
+
+    ifstream current(output);
+    stringstream existing;
+    existing << current.rdbuf();
+    if (current && existing.str() == header.str())
+        return 0;
+    ofstream file(output, ios::trunc);
+    file << header.str();
+    return file ? 0 : 1;
+}
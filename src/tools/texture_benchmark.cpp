@@ -0,0 +1,68 @@
+// texture_benchmark: times the CPU side of texture loading on a directory of images.
+//
+//     texture_benchmark <image directory> [repeats] [mip size]
+//
+// decodes the JPEGs and then the PNGs of the directory from memory with stb_image's SIMD and wide-word paths and with
+// its scalar code, and prints megapixels per second of both and the largest difference between their pixels per format
+// (see TextureLoader::benchmarkDecode). Then builds the mip chain of a generated mip size x mip size RGBA image (2048 by
+// default) with MipBuilder's SIMD and threaded path and with its scalar reference (see MipBuilder::benchmark).
+// no GL context is needed
+#include <learnopengl/texture_loader.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// the files of directory with one of the extensions, in name order so runs compare
+static vector<string> listImages(const string &directory, const vector<string> &extensions)
+{
+    vector<string> paths;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file())
+            continue;
+        string extension = entry.path().extension().string();
+        transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        if (find(extensions.begin(), extensions.end(), extension) != extensions.end())
+            paths.push_back(entry.path().filename().string());
+    }
+    if (error)
+        cout << "ERROR::TEXTURE_BENCHMARK::DIRECTORY_NOT_READ " << directory << ": " << error.message() << endl;
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static void benchmarkFormat(const string &format, const vector<string> &paths, const string &directory, int repeats)
+{
+    if (paths.empty())
+    {
+        cout << "TEXTURE_BENCHMARK:: no " << format << " images in " << directory << endl;
+        return;
+    }
+    cout << "TEXTURE_BENCHMARK:: " << format << endl;
+    TextureLoader::benchmarkDecode(paths, directory, repeats);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cout << "usage: texture_benchmark <image directory> [repeats] [mip size]" << endl;
+        return 1;
+    }
+    const string directory = argv[1];
+    const int repeats = argc > 2 ? max(1, atoi(argv[2])) : 3;
+    const int mipSize = argc > 3 ? max(1, atoi(argv[3])) : 2048;
+
+    benchmarkFormat("JPEG", listImages(directory, { ".jpg", ".jpeg" }), directory, repeats);
+    benchmarkFormat("PNG", listImages(directory, { ".png" }), directory, repeats);
+    MipBuilder::benchmark(mipSize);
+    return 0;
+}